@@ -13,6 +13,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace wind
 {
@@ -58,7 +59,6 @@ namespace wind
 			initialise_buffer(buffer, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
 				device, sizeof(GlobalUBO));
-			vkMapMemory(device.device(), buffer.memory, 0, sizeof(GlobalUBO), 0, &buffer.data);
 		}
 
 		//this whole block should look better
@@ -100,20 +100,24 @@ namespace wind
 		}
 
 		SimpleRenderSystem simpleRenderSystem{device, lveRenderer.getSwapChainRenderPass(), layout}; //pipeline is created here
-		for (auto &kv : gameObjects)
+		PhysicsStepper physics{};
+		for (size_t i = 0; i < scene.rigidBodies.size(); i++)
 		{
-			auto &obj = kv.second;
-
-			if (obj.mass == EARTH)
-				simpleRenderSystem.floor_y = obj.transform.translation.y;
+			if (scene.rigidBodies[i].mass == EARTH)
+				physics.floorY = scene.transforms.get(scene.rigidBodies.entity(i))->translation.y;
 		}
+		gpuCullingSupported = simpleRenderSystem.supportsGpuDriven();
 		PointLightSystem pointLightSystem{device, lveRenderer.getSwapChainRenderPass(), layout};
+		RenderQueue renderQueue{}; //both systems submit into it, draws are recorded in key order
+		TransformBatch transformBatch{};
+		RenderState renderState{};
 		LveCamera camera{};
 		camera.setViewTarget(glm::vec3(-1.f, -2.f, 2.f), glm::vec3(0.f, 0.f, 2.5f));
 
-		auto viewerObject = LveGameObject::createGameObject();
-		viewerObject.transform.translation.z = -5.5f;
-		Player player(viewerObject);
+		Entity viewer = scene.createEntity();
+		scene.transforms.get(viewer)->translation.z = -5.5f;
+		scene.players.add(viewer);
+		Player player(viewer);
 
 		KeyboardMovementController cameraController{};
 
@@ -126,8 +130,9 @@ namespace wind
 			float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
 			currentTime = newTime;
 
-			cameraController.moveInPlaneXZ(appWindow.getGLFWwindow(), frameTime, viewerObject);
-			camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+			TransformComponent &viewerTransform = *scene.transforms.get(viewer); //spawning may move it in the pool
+			cameraController.moveInPlaneXZ(appWindow.getGLFWwindow(), frameTime, viewerTransform);
+			camera.setViewYXZ(viewerTransform.translation, viewerTransform.rotation);
 
 			float aspect = lveRenderer.getAspectRatio();
 			camera.setPerspectiveProjection(glm::radians(50.f), aspect, .1f, 50.f); //last 2 values are very relevant here cause objects outside these bounds will get clipped
@@ -141,31 +146,51 @@ namespace wind
 					commandBuffer,
 					camera,
 					globalDescriptorSets[frameIndex],
-					gameObjects
+					scene,
+					static_cast<float>(lveRenderer.getSwapChainExtent().height)
 				};
 
 
+				scene.updateLifetimes(frameTime); //expired entities are only destroyed at the end of the frame
+				if (debrisStream)
+					spawnDebris(DEBRIS_PER_FRAME);
+
 				//update UBO /other buffers later maybe
 				ubo.projection = camera.getProjection();
 				ubo.view = camera.getView();
 				ubo.inverseView = camera.getInverseViewMatrix();
 				pointLightSystem.update(frameInfo, ubo);
 				
-				//selfexplanatory
-				simpleRenderSystem.applyPhysics(frameInfo, ubo);
+				//fixed ticks, the transforms end up between the last two
+				physics.advance(scene, frameTime);
+				physicsSteps = physics.getLastSteps();
+				collisionPairs = physics.getCollisions().getPairCount();
+				collisionContacts = physics.getCollisions().getContactCount();
+				sleepingBodies = physics.getCollisions().getSleepingCount();
 				if (multiPlayer == 1) {
 					client->Send(player);
 
 					client->Recv();
 				}
 				memcpy(uboBuffers[frameIndex].data, &ubo, sizeof(GlobalUBO));
+				//everything that moves objects ran, the systems below only read the cached matrices
+				transformsComposed = static_cast<uint32_t>(transformBatch.update(scene));
 
 
 				//render phase ORDER MATTERS 
+				simpleRenderSystem.gpuDriven = gpuCulling;
+				simpleRenderSystem.cullGameObjects(frameInfo); //compute, can't be inside the render pass
+				renderQueue.clear();
+				simpleRenderSystem.submit(frameInfo, renderQueue);
+				pointLightSystem.submit(frameInfo, renderQueue);
+				renderQueue.sort();
+
 				lveRenderer.beginSwapchainRenderPass(commandBuffer);
-				simpleRenderSystem.renderGameObjects(frameInfo);
+				renderState.begin(commandBuffer);
+				renderQueue.execute(frameInfo, renderState);
+				renderStats = simpleRenderSystem.getStats();
+				stateStats = renderState.getStats();
 				
-				pointLightSystem.render(frameInfo);
 				RenderImgui(commandBuffer);
 
 				//end frame
@@ -173,8 +198,16 @@ namespace wind
 				lveRenderer.endSwapchainRenderPass(commandBuffer);
 				lveRenderer.endFrame();
 			}
+			//streamed models get attached and destroyed entities removed here, between frames, so nothing is iterating the scene
+			scene.flushDestroyed();
+			if (assets.update(lveRenderer.getSubmittedFrameCount()) > 0 && !assets.isStreaming())
+			{
+				printGeometryReport();
+				assets.printMemoryReport();
+				device.memoryAllocator().printStats();
+			}
 		}
-		vkDeviceWaitIdle(device.device());
+		device.waitIdle();
 
 
 		//memory cleanup
@@ -195,43 +228,40 @@ namespace wind
 
 	void App::LoadGameObjects()
 	{
-		std::shared_ptr<LveModel> lveModel = LveModel::createModel_from_file(device, "obj_models/flat_vase.obj");
-
-		auto flatVase = LveGameObject::createGameObject();
-		flatVase.model = lveModel;
-		flatVase.transform.translation = {0.5f, 0.3f, 0.f};
-		flatVase.transform.scale = 3.0f;
-		flatVase.mass = 0.3f;
-		gameObjects.emplace(flatVase.getId(), std::move(flatVase));
-
-		lveModel = LveModel::createModel_from_file(device, "obj_models/smooth_vase.obj");
-
-		auto smoothVase = LveGameObject::createGameObject();
-		smoothVase.model = lveModel;
-		smoothVase.transform.translation = {-0.5f, -2.5f, 0.f};
-		smoothVase.transform.scale = 3.0f;
-		smoothVase.mass = 0.3f;
-		gameObjects.emplace(smoothVase.getId(), std::move(smoothVase));
-
-		lveModel = LveModel::createModel_from_file(device, "obj_models/smooth_vase.obj");
-
-		auto playerVase = LveGameObject::createGameObject();
-		playerVase.model = lveModel;
-		playerVase.transform.translation = {0.f, 0.3f, 0.5f};
-		playerVase.transform.scale = 3.0f;
-		playerVase.mass = 0.3f;
-		gameObjects.emplace(playerVase.getId(), std::move(playerVase));
-
-		
-
-		lveModel = LveModel::createModel_from_file(device, "obj_models/floor.obj");
-
-		auto floor = LveGameObject::createGameObject();
-		floor.model = lveModel;
-		floor.transform.translation = {0.f, 0.5f, 0.f};
-		floor.transform.scale = 3.0f;
-		floor.mass = EARTH;
-		gameObjects.emplace(floor.getId(), std::move(floor));
+		//vases stream in the background, they show up once their model is resident
+		Entity flatVase = scene.createEntity();
+		auto &flatVaseTransform = *scene.transforms.get(flatVase);
+		flatVaseTransform.translation = {0.5f, 0.3f, 0.f};
+		flatVaseTransform.scale = 3.0f;
+		scene.rigidBodies.add(flatVase).mass = 0.3f;
+		streamModel(flatVase, "obj_models/flat_vase.obj", LveModel::VertexFormat::Quantized);
+
+		Entity smoothVase = scene.createEntity();
+		auto &smoothVaseTransform = *scene.transforms.get(smoothVase);
+		smoothVaseTransform.translation = {-0.5f, -2.5f, 0.f};
+		smoothVaseTransform.scale = 3.0f;
+		scene.rigidBodies.add(smoothVase).mass = 0.3f;
+		streamModel(smoothVase, "obj_models/smooth_vase.obj", LveModel::VertexFormat::Quantized);
+
+		Entity playerVase = scene.createEntity();
+		auto &playerVaseTransform = *scene.transforms.get(playerVase);
+		playerVaseTransform.translation = {0.f, 0.3f, 0.5f};
+		playerVaseTransform.scale = 3.0f;
+		scene.rigidBodies.add(playerVase).mass = 0.3f;
+		streamModel(playerVase, "obj_models/smooth_vase.obj", LveModel::VertexFormat::Quantized);
+
+		//the floor is tiny, no point streaming it
+		std::shared_ptr<LveModel> lveModel = assets.loadModel("obj_models/floor.obj");
+
+		Entity floor = scene.createEntity();
+		auto &floorTransform = *scene.transforms.get(floor);
+		floorTransform.translation = {0.f, 0.5f, 0.f};
+		floorTransform.scale = 3.0f;
+		scene.meshes.add(floor, {lveModel});
+		scene.rigidBodies.add(floor).mass = EARTH;
+		ColliderComponent floorCollider{};
+		floorCollider.shape = ColliderShape::Plane; //through the floor position, facing up (-y)
+		scene.colliders.add(floor, floorCollider);
 		
 		std::vector<glm::vec3> lightColors {
 			{1.f, .1f, .1f},
@@ -244,24 +274,64 @@ namespace wind
 
 		for (int i = 0; i < lightColors.size(); i++)
 		{
-			auto pointLight = LveGameObject::create_point_light(0.2f);
-			pointLight.color = lightColors[i];
+			Entity pointLight = scene.createPointLight(0.2f, lightColors[i]);
 			auto rotateLight = glm::rotate(
 				glm::mat4(1.f),
 				(i * glm::two_pi<float>()) / lightColors.size(),
 				{0.f, -1.f, 0.f});
-			pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
-			gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+			scene.transforms.get(pointLight)->translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
 		}
 
 
 		// std::shared_ptr<LveModel> lveModel = LveModel::createModel_from_file(device, "obj_models/viking_room.obj");
 
-		// auto viking = LveGameObject::createGameObject();
-		// viking.model = lveModel;
-		// viking.transform.translation = {0.f, 0.5f, 0.f};
-		// viking.transform.scale = 3.0f;
-		// gameObjects.emplace(viking.getId(), std::move(viking));
+		// Entity viking = scene.createEntity();
+		// scene.meshes.add(viking, {lveModel});
+		// scene.transforms.get(viking)->translation = {0.f, 0.5f, 0.f};
+		// scene.transforms.get(viking)->scale = 3.0f;
+
+	}
+
+	void App::streamModel(Entity entity, const std::string &filepath, LveModel::VertexFormat format)
+	{
+		assets.loadModelAsync(filepath, format, [this, entity](std::shared_ptr<LveModel> model)
+		{
+			if (!scene.isAlive(entity)) //the entity may have been destroyed while its model was loading
+				return;
+			if (scene.rigidBodies.has(entity))
+				scene.colliders.add(entity, colliderFromModel(*model, scene.transforms.get(entity)->scale));
+			scene.meshes.add(entity, {std::move(model)});
+		});
+	}
+
+	//gpu memory held by the loaded models and what one frame of draws fetches, against a 44 byte vertex / uint32 index baseline
+	void App::printGeometryReport()
+	{
+		std::unordered_set<const LveModel *> models;
+		VkDeviceSize vertexBytes = 0, indexBytes = 0, fullVertexBytes = 0, fullIndexBytes = 0;
+		VkDeviceSize frameIndexBytes = 0, frameFullIndexBytes = 0;
+
+		for (const MeshComponent &mesh : scene.meshes)
+		{
+			const LveModel *model = mesh.model.get();
+			if (model == nullptr)
+				continue;
+			//every draw reads the whole index buffer once
+			frameIndexBytes += model->getIndexBufferSize();
+			frameFullIndexBytes += static_cast<VkDeviceSize>(model->getIndexCount()) * sizeof(uint32_t);
+			if (!models.insert(model).second)
+				continue;
+			vertexBytes += model->getVertexBufferSize();
+			indexBytes += model->getIndexBufferSize();
+			fullVertexBytes += model->getVertexBufferSize() / LveModel::vertexStride(model->getVertexFormat()) * sizeof(LveModel::Vertex);
+			fullIndexBytes += static_cast<VkDeviceSize>(model->getIndexCount()) * sizeof(uint32_t);
+			std::cout << "  model " << model << " : " << model->getVertexBufferSize() << " vertex bytes, "
+				<< model->getIndexCount() << " indices as " << (model->getIndexType() == VK_INDEX_TYPE_UINT16 ? "uint16" : "uint32")
+				<< " (" << model->getIndexBufferSize() << " bytes)" << std::endl;
+		}
+		std::cout << "Geometry : " << models.size() << " models, vertex buffers " << vertexBytes << " bytes (" << fullVertexBytes
+			<< " uncompressed), index buffers " << indexBytes << " bytes (" << fullIndexBytes << " as uint32)" << std::endl;
+		std::cout << "Index fetch per frame : " << frameIndexBytes << " bytes (" << frameFullIndexBytes << " as uint32)" << std::endl;
 	}
 
 	void App::initImGui()
@@ -318,6 +388,26 @@ namespace wind
 						std::cout << "Add vase pressed" << std::endl;
 						spawnVase();
 					}
+					if (ImGui::Button("Debris burst"))
+						spawnDebris(DEBRIS_BURST);
+					ImGui::Checkbox("Debris stream", &debrisStream);
+					ImGui::EndTabItem();
+				}
+				if (ImGui::BeginTabItem("Stats"))
+				{
+					ImGui::Text("Objects drawn: %u culled: %u", renderStats.objectsDrawn, renderStats.objectsCulled);
+					ImGui::Text("Clusters drawn: %u culled: %u", renderStats.clustersDrawn, renderStats.clustersCulled);
+					ImGui::Text("Draw calls: %u, %u objects instanced", renderStats.drawCalls, renderStats.instancedObjects);
+					if (renderStats.objectsDropped > 0)
+						ImGui::Text("Objects dropped: %u (object buffer full)", renderStats.objectsDropped);
+					ImGui::Text("Binds: %u pipeline, %u descriptor, %u buffer, %u redundant skipped",
+						stateStats.pipelineBinds, stateStats.descriptorBinds, stateStats.bufferBinds, stateStats.redundant());
+					ImGui::Text("Transforms composed: %u", transformsComposed);
+					ImGui::Text("Physics steps: %u this frame, %s kernel", physicsSteps, kernelName(bestIntegrationKernel()));
+					ImGui::Text("Collisions: %u pairs, %u contacts, %u asleep", collisionPairs, collisionContacts, sleepingBodies);
+					ImGui::Text("Entities: %zu alive, %zu free slots", scene.aliveCount(), scene.freeSlotCount());
+					if (gpuCullingSupported)
+						ImGui::Checkbox("GPU culling", &gpuCulling);
 					ImGui::EndTabItem();
 				}
 				ImGui::EndTabBar();
@@ -353,6 +443,39 @@ namespace wind
 
 	void App::spawnVase()
 	{
-		
+		static int spawned = 0; //walks a small grid next to the other vases
+
+		Entity vase = scene.createEntity();
+		auto &transform = *scene.transforms.get(vase);
+		transform.translation = {-1.5f + 0.5f * (spawned % 7), -2.5f, 1.f + 0.5f * (spawned / 7 % 7)};
+		transform.scale = 3.0f;
+		scene.rigidBodies.add(vase).mass = 0.3f;
+		streamModel(vase, "obj_models/smooth_vase.obj", LveModel::VertexFormat::Quantized); //only the first request uploads
+		spawned++;
+	}
+
+	void App::spawnDebris(uint32_t count)
+	{
+		static uint32_t spawned = 0;
+
+		//every piece shares one model, it is looked up once and the pieces only copy the shared_ptr
+		if (debrisModel == nullptr)
+			debrisModel = assets.loadModel("obj_models/smooth_vase.obj", LveModel::VertexFormat::Quantized);
+		const ColliderComponent debrisCollider = colliderFromModel(*debrisModel, 0.5f);
+		for (uint32_t i = 0; i < count; i++, spawned++)
+		{
+			Entity piece = scene.createEntity();
+			auto &transform = *scene.transforms.get(piece);
+			//golden angle spiral above the vases, they fall on the floor and vanish
+			const float angle = spawned * 2.39996f;
+			const float radius = 0.2f + 0.02f * (spawned % 64);
+			transform.translation = {radius * glm::cos(angle), -3.f, 1.f + radius * glm::sin(angle)};
+			transform.rotation.y = angle;
+			transform.scale = 0.5f;
+			scene.meshes.add(piece, {debrisModel});
+			scene.rigidBodies.add(piece).mass = 0.05f;
+			scene.colliders.add(piece, debrisCollider);
+			scene.lifetimes.add(piece, {DEBRIS_LIFETIME});
+		}
 	}
 }
\ No newline at end of file
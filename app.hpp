@@ -1,12 +1,16 @@
 #pragma once
 
 #include "window.hpp"
-#include "game_object.hpp"
+#include "scene.hpp"
 #include "engine.hpp"
 #include "renderer.hpp"
 #include "client.hpp"
 #include "player.hpp"
 #include "descriptors.hpp"
+#include "asset_manager.hpp"
+#include "simple_render_system.hpp"
+#include "transform_batch.hpp"
+#include "physics_stepper.hpp"
 #include "imgui.h"
 #include "imgui/backends/imgui_impl_glfw.h"
 #include "imgui/backends/imgui_impl_vulkan.h"
@@ -34,20 +38,42 @@ namespace wind
 			private:
 
 			void LoadGameObjects();
+			void printGeometryReport();
+			//attaches the model to the object once it is resident, the object is not drawn until then
+			//and a rigid body only collides from then on, its collider comes from the model bounds
+			void streamModel(Entity entity, const std::string &filepath, LveModel::VertexFormat format);
 			void connectToServer(std::string &input);
 			void initImGui();
 			void spawnVase();
+			//short lived vases, destroyed by their lifetime, to stress entity creation and destruction
+			void spawnDebris(uint32_t count);
 
 			Window appWindow{WIDTH, HEIGHT, "wind"}; //initialises the window instance with GLFW
 			EngineDevice device{appWindow};//sets up validation layer, bind glfw with our vkinstance and vksurfaceKHR finds the physical device, creates our logical device binds it with the command pool 
 			LveRenderer lveRenderer{appWindow, device};
+			AssetManager assets{device}; //every model goes through here so shared meshes are uploaded once
 			std::unique_ptr<Client> client = nullptr;
 			
 			DescriptorPool				globalDescriptorPool;//[LveSwapChain::MAX_FRAMES_IN_FLIGHT]; //a class that pre allocates some VkDescriptorPool 
 			DescriptorPool				imGuiDescriptorPool;
 			ImGui_ImplVulkan_InitInfo	infoImGui{};
 
-			LveGameObject::Map	gameObjects;
+			Scene				scene; //every entity and its components
 			bool multiPlayer = false;
+			RenderStats			renderStats{}; //last frame, shown in the menu
+			StateChangeStats	stateStats{};
+			uint32_t			transformsComposed = 0; //dirty transforms of the last frame
+			uint32_t			physicsSteps = 0; //fixed ticks run by the last frame
+			uint32_t			collisionPairs = 0; //broadphase pairs and contacts of the last tick
+			uint32_t			collisionContacts = 0;
+			uint32_t			sleepingBodies = 0;
+			bool				gpuCullingSupported = false;
+			bool				gpuCulling = false; //menu toggle for SimpleRenderSystem::gpuDriven
+
+			static constexpr uint32_t	DEBRIS_BURST = 512;
+			static constexpr uint32_t	DEBRIS_PER_FRAME = 32;
+			static constexpr float		DEBRIS_LIFETIME = 2.f; //seconds
+			std::shared_ptr<LveModel>	debrisModel{};
+			bool						debrisStream = false; //menu toggle, spawns DEBRIS_PER_FRAME every frame
 	};
 }
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "asset_manager.hpp"
+#include "mapped_file.hpp"
+#include "swap_chain.hpp"
+#include "utils.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace wind
+{
+	std::string AssetManager::canonicalPath(const std::string &filepath)
+	{
+		std::error_code error;
+		std::string canonical = std::filesystem::weakly_canonical(filepath, error).string();
+		return error ? filepath : canonical;
+	}
+
+	std::string AssetManager::pathKey(const std::string &canonicalPath, LveModel::VertexFormat format)
+	{
+		return canonicalPath + '#' + std::to_string(static_cast<int>(format));
+	}
+
+	uint64_t AssetManager::contentKey(const std::string &filepath, LveModel::VertexFormat format)
+	{
+		MappedFile source;
+		if (!source.open(filepath))
+			throw std::runtime_error("failed to open file " + filepath);
+		uint64_t formatValue = static_cast<uint64_t>(format);
+		return hashBytes(source.data(), source.size(), hashBytes(&formatValue, sizeof(formatValue)));
+	}
+
+	std::shared_ptr<LveModel> AssetManager::loadModel(const std::string &filepath, LveModel::VertexFormat format)
+	{
+		const std::string canonical = canonicalPath(filepath);
+		const std::string key = pathKey(canonical, format);
+
+		auto path = pathKeys.find(key);
+		if (path != pathKeys.end())
+		{
+			auto cached = models.find(path->second);
+			if (cached != models.end())
+			{
+				cached->second.lastUsedFrame = submittedFrames;
+				return cached->second.model;
+			}
+			pathKeys.erase(path); //evicted since, go through the content check again
+		}
+
+		//a copy of the same file under another name is still the same model
+		uint64_t modelKey = contentKey(filepath, format);
+		pathKeys[key] = modelKey;
+
+		auto cached = models.find(modelKey);
+		if (cached != models.end())
+		{
+			cached->second.lastUsedFrame = submittedFrames;
+			return cached->second.model;
+		}
+
+		ModelAsset asset{};
+		try
+		{
+			asset.model = LveModel::createModel_from_file(device, geometry, filepath, uploads, format, &parseThreads);
+		}
+		catch (...) //its copies may point into geometry it already gave back
+		{
+			uploads.discard();
+			throw;
+		}
+		uploads.wait(uploads.flush());
+		asset.path = canonical;
+		asset.format = format;
+		asset.lastUsedFrame = submittedFrames;
+		return models.emplace(modelKey, std::move(asset)).first->second.model;
+	}
+
+	void AssetManager::loadModelAsync(const std::string &filepath, LveModel::VertexFormat format, OnLoaded onLoaded)
+	{
+		const std::string canonical = canonicalPath(filepath);
+		const std::string key = pathKey(canonical, format);
+
+		auto path = pathKeys.find(key);
+		if (path != pathKeys.end())
+		{
+			auto cached = models.find(path->second);
+			if (cached != models.end())
+			{
+				cached->second.lastUsedFrame = submittedFrames;
+				onLoaded(cached->second.model);
+				return;
+			}
+		}
+
+		auto inFlight = streaming.find(key);
+		if (inFlight != streaming.end())
+		{
+			inFlight->second.push_back(std::move(onLoaded));
+			return;
+		}
+		streaming[key].push_back(std::move(onLoaded));
+
+		//the worker fills modelKey before the model comes back, poll() orders the two
+		auto modelKey = std::make_shared<uint64_t>(0);
+		EngineDevice &device = this->device;
+		GeometryPool &geometry = this->geometry;
+		ThreadPool &parseThreads = this->parseThreads;
+		streamer.request(
+			[&device, &geometry, &parseThreads, filepath, format, modelKey](UploadBatcher &uploads) -> std::shared_ptr<LveModel>
+			{
+				*modelKey = contentKey(filepath, format);
+				return LveModel::createModel_from_file(device, geometry, filepath, uploads, format, &parseThreads);
+			},
+			[this, key, canonical, format, modelKey](std::shared_ptr<LveModel> model)
+			{
+				finishAsyncLoad(key, canonical, format, *modelKey, std::move(model));
+			});
+	}
+
+	void AssetManager::finishAsyncLoad(const std::string &key, const std::string &canonical, LveModel::VertexFormat format,
+		uint64_t modelKey, std::shared_ptr<LveModel> model)
+	{
+		std::vector<OnLoaded> waiting = std::move(streaming[key]);
+		streaming.erase(key);
+		if (model == nullptr)
+			return; //the streamer already reported why
+
+		auto cached = models.find(modelKey);
+		if (cached != models.end()) //same content finished under another path meanwhile, keep the first copy
+			model = cached->second.model;
+		else
+		{
+			ModelAsset asset{};
+			asset.model = model;
+			asset.path = canonical;
+			asset.format = format;
+			asset.lastUsedFrame = submittedFrames;
+			models.emplace(modelKey, std::move(asset));
+		}
+		pathKeys[key] = modelKey;
+
+		for (OnLoaded &onLoaded : waiting)
+			onLoaded(model);
+	}
+
+	size_t AssetManager::update(uint64_t submittedFrames)
+	{
+		this->submittedFrames = submittedFrames;
+		size_t finished = streamer.poll();
+		collectGarbage();
+		return finished;
+	}
+
+	void AssetManager::collectGarbage()
+	{
+		size_t released = 0;
+		for (auto it = models.begin(); it != models.end();)
+		{
+			ModelAsset &asset = it->second;
+			if (asset.model.use_count() > 1)
+				asset.lastUsedFrame = submittedFrames;
+			else if (submittedFrames - asset.lastUsedFrame > LveSwapChain::MAX_FRAMES_IN_FLIGHT)
+			{
+				std::cout << "Released model " << asset.path << std::endl;
+				it = models.erase(it); //pathKeys entries pointing here are dropped lazily by loadModel
+				released++;
+				continue;
+			}
+			++it;
+		}
+		//uploads record the pool buffers, they can't be swapped while one may be in flight
+		if (released > 0 && !isStreaming() && geometry.getFragmentation() > COMPACT_FRAGMENTATION)
+			geometry.compact();
+	}
+
+	void AssetManager::printMemoryReport() const
+	{
+		VkDeviceSize total = 0;
+		std::cout << "Assets : " << models.size() << " models" << std::endl;
+		for (const auto &kv : models)
+		{
+			const ModelAsset &asset = kv.second;
+			VkDeviceSize vertexBytes = asset.model->getVertexBufferSize();
+			VkDeviceSize indexBytes = asset.model->getIndexBufferSize();
+			total += vertexBytes + indexBytes;
+			std::cout << "  " << asset.path << " : " << vertexBytes << " vertex bytes + " << indexBytes << " index bytes, "
+				<< asset.model->getLodCount() << " lods, " << asset.model.use_count() - 1 << " users" << std::endl;
+		}
+		std::cout << "  total : " << total << " bytes of device memory" << std::endl;
+		geometry.printStats();
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "model.hpp"
+#include "asset_streamer.hpp"
+#include "upload_batcher.hpp"
+#include "thread_pool.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wind
+{
+	//owns every model loaded from disk, the same file (by canonical path or by content) is only
+	//parsed and uploaded once, everyone else gets the same shared_ptr
+	class AssetManager
+	{
+		public:
+			using OnLoaded = std::function<void(std::shared_ptr<LveModel> model)>;
+
+			AssetManager(EngineDevice &device) : device{device}, geometry{device}, uploads{device}, parseThreads{}, streamer{device} {}
+			~AssetManager() = default;
+
+			AssetManager(const AssetManager &) = delete;
+			AssetManager& operator=(const AssetManager &) = delete;
+
+			//blocks until the model is resident
+			std::shared_ptr<LveModel> loadModel(const std::string &filepath, LveModel::VertexFormat format = LveModel::VertexFormat::Full);
+			//parsed and uploaded on the streaming thread, onLoaded runs from update() once the model is resident
+			//(right away if it already is), concurrent requests for the same file share one load
+			void loadModelAsync(const std::string &filepath, LveModel::VertexFormat format, OnLoaded onLoaded);
+
+			//call once per loop : delivers streamed models then collects garbage, returns how many loads finished
+			//submittedFrames is LveRenderer::getSubmittedFrameCount(), eviction is counted in submitted frames
+			size_t update(uint64_t submittedFrames);
+			//a model nobody but the manager references for more than the frames in flight (submitted ones) is released,
+			//by then no command buffer can still be drawing it
+			//the geometry pool is compacted after releases once it gets too fragmented and nothing is streaming
+			void collectGarbage();
+			bool isStreaming() const { return streamer.pendingCount() > 0; }
+			void printMemoryReport() const;
+
+			size_t getModelCount() const { return models.size(); }
+			GeometryPool &getGeometryPool() { return geometry; }
+
+		private:
+			struct ModelAsset
+			{
+				std::shared_ptr<LveModel>	model;
+				std::string					path; //first path it was loaded from
+				LveModel::VertexFormat		format;
+				uint64_t					lastUsedFrame = 0; //submitted frame count when someone else still held it
+			};
+
+			//both return the key of models, the content one also hashes the file
+			static std::string pathKey(const std::string &canonicalPath, LveModel::VertexFormat format);
+			static uint64_t contentKey(const std::string &filepath, LveModel::VertexFormat format);
+			static std::string canonicalPath(const std::string &filepath);
+			void finishAsyncLoad(const std::string &key, const std::string &canonical, LveModel::VertexFormat format,
+				uint64_t modelKey, std::shared_ptr<LveModel> model);
+
+			static constexpr float COMPACT_FRAGMENTATION = 0.5f; //share of free pool space outside the largest hole
+
+			EngineDevice &device;
+			GeometryPool geometry; //before the streamer and the models, they all point into it
+			UploadBatcher uploads; //loadModel's, main thread only, the streamer has its own for the worker
+			ThreadPool parseThreads; //shared by loadModel and the streaming worker, before the streamer that uses it
+			AssetStreamer streamer;
+
+			uint64_t submittedFrames = 0; //as of the last update
+			std::unordered_map<uint64_t, ModelAsset> models; //key mixes the file content hash and the vertex format
+			std::unordered_map<std::string, uint64_t> pathKeys; //canonical path + format -> models key, skips hashing the file again
+			std::unordered_map<std::string, std::vector<OnLoaded>> streaming; //path keys in flight and who waits on them
+	};
+}
@@ -0,0 +1,111 @@
+#include "asset_streamer.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace wind
+{
+	AssetStreamer::AssetStreamer(EngineDevice &device) : device{device}, uploads{device}
+	{
+		worker = std::thread(&AssetStreamer::workerLoop, this);
+	}
+
+	AssetStreamer::~AssetStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			requests.clear();
+		}
+		wake.notify_one();
+		worker.join();
+		results.clear(); //finished models nobody picked up, their uploads are complete so this is safe
+	}
+
+	void AssetStreamer::request(LoadJob job, OnResident onResident)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.push_back({std::move(job), std::move(onResident)});
+		}
+		pending++;
+		wake.notify_one();
+	}
+
+	size_t AssetStreamer::poll()
+	{
+		std::vector<Result> finished;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (results.empty())
+				return 0;
+			finished.swap(results);
+		}
+		for (Result &result : finished) //callbacks run unlocked, they are free to request more
+		{
+			if (!result.error.empty())
+				std::cerr << "streaming failed : " << result.error << std::endl;
+			pending--;
+			result.onResident(std::move(result.model));
+		}
+		return finished.size();
+	}
+
+	void AssetStreamer::workerLoop()
+	{
+		for (;;)
+		{
+			std::vector<Request> batch;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return stopping || !requests.empty(); });
+				if (stopping)
+					return;
+				while (!requests.empty() && batch.size() < MAX_JOBS_PER_SUBMIT)
+				{
+					batch.push_back(std::move(requests.front()));
+					requests.pop_front();
+				}
+			}
+
+			std::vector<Result> finished(batch.size());
+			for (size_t i = 0; i < batch.size(); i++)
+				finished[i].onResident = std::move(batch[i].onResident);
+			for (size_t i = 0; i < batch.size(); i++)
+			{
+				if (!finished[i].error.empty())
+					continue;
+				try
+				{
+					finished[i].model = batch[i].job(uploads);
+				}
+				catch (const std::exception &e)
+				{
+					//the failed job may have recorded copies into geometry it gave back, drop the open batch
+					//and load the ones before it again, their copies were (maybe only partly) in it too
+					uploads.discard();
+					finished[i].error = e.what();
+					for (size_t j = 0; j < i; j++)
+						finished[j].model = nullptr;
+					i = static_cast<size_t>(-1);
+				}
+			}
+			try
+			{
+				uploads.wait(uploads.flush()); //blocks this thread only, the render loop keeps going
+			}
+			catch (const std::exception &e)
+			{
+				for (Result &result : finished)
+				{
+					result.model = nullptr;
+					result.error = e.what();
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			for (Result &result : finished)
+				results.push_back(std::move(result));
+		}
+	}
+}
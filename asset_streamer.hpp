@@ -0,0 +1,64 @@
+#pragma once
+
+#include "model.hpp"
+#include "upload_batcher.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace wind
+{
+	//one worker thread that loads models off the render thread : jobs parse/decode and record their
+	//copies into the worker UploadBatcher, everything queued at that point goes out in one submit,
+	//the worker waits for it then hands the models back to the main thread through poll(), resident
+	class AssetStreamer
+	{
+		public:
+			using LoadJob = std::function<std::shared_ptr<LveModel>(UploadBatcher &uploads)>; //runs on the worker
+			static constexpr size_t MAX_JOBS_PER_SUBMIT = 32; //bounds how long the first model of a batch waits
+			using OnResident = std::function<void(std::shared_ptr<LveModel> model)>; //runs in poll(), nullptr if the job threw
+
+			AssetStreamer(EngineDevice &device);
+			~AssetStreamer(); //drops what is still queued, waits for the job in progress
+
+			AssetStreamer(const AssetStreamer &) = delete;
+			AssetStreamer& operator=(const AssetStreamer &) = delete;
+
+			void request(LoadJob job, OnResident onResident);
+			//main thread, once per frame, returns how many callbacks ran
+			size_t poll();
+			size_t pendingCount() const { return pending; }
+
+		private:
+			struct Request
+			{
+				LoadJob		job;
+				OnResident	onResident;
+			};
+			struct Result
+			{
+				std::shared_ptr<LveModel>	model;
+				OnResident					onResident;
+				std::string					error;
+			};
+
+			void workerLoop();
+
+			EngineDevice			&device;
+			UploadBatcher			uploads; //only ever used by the worker
+
+			std::mutex				mutex; //guards everything below except pending
+			std::condition_variable	wake;
+			std::deque<Request>		requests;
+			std::vector<Result>		results;
+			bool					stopping = false;
+			size_t					pending = 0; //main thread only
+			std::thread				worker; //last, starts once the rest is initialised
+	};
+}
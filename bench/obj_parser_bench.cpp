@@ -0,0 +1,151 @@
+//compares the chunked obj parser against the old tinyobj import path
+//build with `make bench_obj` and run it from the repo root
+
+#include "model.hpp"
+#include "obj_parser.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+using namespace wind;
+
+namespace
+{
+	struct VertexHash
+	{
+		size_t operator()(LveModel::Vertex const &vertex) const
+		{
+			size_t seed = 0;
+			hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+			return seed;
+		}
+	};
+
+	//the import path as it was before the chunked parser, kept here as the reference
+	void tinyobjLoad(const std::string &filepath, LveModel::Builder &builder)
+	{
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warn, error;
+
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &error, filepath.c_str()))
+			throw std::runtime_error(warn + error);
+		builder.vertices.clear();
+		builder.indices.clear();
+
+		std::unordered_map<LveModel::Vertex, uint32_t, VertexHash> unique_vertices{};
+		for (const auto &shape : shapes)
+		{
+			for (const auto &mesh_index : shape.mesh.indices)
+			{
+				LveModel::Vertex vertex{};
+				if (mesh_index.vertex_index >= 0)
+				{
+					vertex.position = {
+						attrib.vertices[3 * mesh_index.vertex_index + 0],
+						attrib.vertices[3 * mesh_index.vertex_index + 1],
+						attrib.vertices[3 * mesh_index.vertex_index + 2]};
+					vertex.color = {
+						attrib.colors[3 * mesh_index.vertex_index + 0],
+						attrib.colors[3 * mesh_index.vertex_index + 1],
+						attrib.colors[3 * mesh_index.vertex_index + 2]};
+				}
+				if (mesh_index.normal_index >= 0)
+				{
+					vertex.normal = {
+						attrib.normals[3 * mesh_index.normal_index + 0],
+						attrib.normals[3 * mesh_index.normal_index + 1],
+						attrib.normals[3 * mesh_index.normal_index + 2]};
+				}
+				if (mesh_index.texcoord_index >= 0)
+				{
+					vertex.uv = {
+						attrib.texcoords[2 * mesh_index.texcoord_index + 0],
+						attrib.texcoords[2 * mesh_index.texcoord_index + 1]};
+				}
+				if (unique_vertices.count(vertex) == 0)
+				{
+					unique_vertices[vertex] = static_cast<uint32_t>(builder.vertices.size());
+					builder.vertices.push_back(vertex);
+				}
+				builder.indices.push_back(unique_vertices[vertex]);
+			}
+		}
+	}
+
+	//median of a few runs, the first one also warms the page cache
+	double timeMs(const std::function<void()> &work, int runs)
+	{
+		std::vector<double> samples;
+		for (int i = 0; i < runs; i++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			work();
+			auto end = std::chrono::high_resolution_clock::now();
+			samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		std::sort(samples.begin(), samples.end());
+		return samples[samples.size() / 2];
+	}
+
+	bool sameOutput(const LveModel::Builder &a, const LveModel::Builder &b)
+	{
+		return a.vertices.size() == b.vertices.size()
+			&& a.indices == b.indices
+			&& std::memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(LveModel::Vertex)) == 0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++)
+		files.push_back(argv[i]);
+	if (files.empty())
+		files = {"obj_models/viking_room.obj", "obj_models/smooth_vase.obj", "obj_models/flat_vase.obj"};
+
+	const int runs = 9;
+	ThreadPool pool{}; //started once, like the AssetManager one
+	const unsigned threads = pool.getThreadCount();
+	std::cout << "hardware threads : " << threads << ", median of " << runs << " runs" << std::endl;
+
+	for (const auto &file : files)
+	{
+		LveModel::Builder reference{};
+		LveModel::Builder chunked{};
+		chunked.parseThreads = &pool;
+		ObjData data;
+
+		double tinyParse = timeMs([&] {
+			tinyobj::attrib_t attrib;
+			std::vector<tinyobj::shape_t> shapes;
+			std::vector<tinyobj::material_t> materials;
+			std::string warn, error;
+			tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &error, file.c_str());
+		}, runs);
+		double singleParse = timeMs([&] { parseObjFile(file, data); }, runs);
+		double chunkedParse = timeMs([&] { parseObjFile(file, data, &pool); }, runs);
+		double tinyImport = timeMs([&] { tinyobjLoad(file, reference); }, runs);
+		double chunkedImport = timeMs([&] { chunked.parseObj(file); }, runs);
+
+		std::cout << file << " : " << chunked.vertices.size() << " vertices, " << chunked.indices.size() << " indices" << std::endl;
+		std::cout << "\tparse  tinyobj " << tinyParse << " ms | chunked 1 thread " << singleParse
+			<< " ms | chunked " << threads << " threads " << chunkedParse << " ms" << std::endl;
+		std::cout << "\timport tinyobj " << tinyImport << " ms | chunked " << chunkedImport << " ms" << std::endl;
+		std::cout << "\toutput " << (sameOutput(reference, chunked) ? "identical" : "DIFFERS") << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,204 @@
+//headless run of the fixed step physics : cost per tick, the same simulation under different frame rates,
+//and a resting stack losing its bottom body
+//build with `make bench_physics` and run it from the repo root, optional argument is the body count
+
+#include "physics_stepper.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace wind;
+
+namespace
+{
+	//bodies in columns of a grid at different heights above the floor, so some land early and some keep falling,
+	//every column gets a few bodies that end up stacked
+	void fillScene(Scene &scene, uint32_t bodyCount)
+	{
+		Entity floor = scene.createEntity();
+		scene.transforms.get(floor)->translation = {0.f, 0.5f, 0.f};
+		scene.rigidBodies.add(floor).mass = EARTH;
+		ColliderComponent plane{};
+		plane.shape = ColliderShape::Plane;
+		scene.colliders.add(floor, plane);
+		for (uint32_t i = 0; i < bodyCount; i++)
+		{
+			Entity body = scene.createEntity();
+			const uint32_t column = i % 2500;
+			scene.transforms.get(body)->translation = {0.1f * (column % 50), -0.5f - 0.01f * (i % 997), 0.1f * (column / 50)};
+			scene.rigidBodies.add(body).mass = 0.3f;
+			ColliderComponent collider{};
+			collider.shape = i % 4 == 0 ? ColliderShape::Sphere : ColliderShape::Box;
+			collider.center = {0.f, -0.05f, 0.f};
+			collider.halfExtents = glm::vec3(0.04f, 0.05f, 0.04f);
+			collider.radius = 0.04f;
+			scene.colliders.add(body, collider);
+		}
+	}
+
+	struct Pattern
+	{
+		const char	*name;
+		std::vector<float> frameTimes; //repeated until the simulated time is reached
+	};
+
+	//simulated positions in component order
+	std::vector<glm::vec3> positionsOf(const Scene &scene, const PhysicsStepper &physics)
+	{
+		const RigidBodyStore &bodies = physics.getBodies();
+		std::vector<glm::vec3> positions;
+		for (size_t i = 0; i < scene.rigidBodies.size(); i++)
+		{
+			const uint32_t body = scene.rigidBodies[i].body;
+			positions.push_back({bodies.positionX[body], bodies.positionY[body], bodies.positionZ[body]});
+		}
+		return positions;
+	}
+
+	//drives the stepper with one frame time pattern, returns the final simulated positions
+	//badAlpha counts the frames that left getAlpha() outside [0, 1), elapsed is the time fed to it
+	std::vector<glm::vec3> run(const Pattern &pattern, uint32_t bodyCount, float seconds, PhysicsStepper &physics,
+		uint32_t &badAlpha, double &elapsed)
+	{
+		Scene scene;
+		fillScene(scene, bodyCount);
+		physics.floorY = 0.5f;
+		badAlpha = 0;
+		elapsed = 0.0;
+		for (size_t frame = 0; elapsed < seconds; frame++)
+		{
+			float frameTime = pattern.frameTimes[frame % pattern.frameTimes.size()];
+			physics.advance(scene, frameTime);
+			elapsed += frameTime;
+			const float alpha = physics.getAlpha();
+			if (!(alpha >= 0.f && alpha < 1.f))
+				badAlpha++;
+		}
+		return positionsOf(scene, physics);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const uint32_t bodyCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 10000;
+	const float seconds = 3.f;
+
+	//tick cost through step(), no accumulator involved
+	//in 3 second phases : the bodies fall through each other's heights, land and stack, then stay at rest
+	{
+		Scene scene;
+		fillScene(scene, bodyCount);
+		PhysicsStepper physics{};
+		physics.floorY = 0.5f;
+		const uint32_t ticks = 360;
+		std::cout << bodyCount << " bodies" << std::endl;
+		for (const char *phase : {"falling", "settling", "at rest"})
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < ticks; i++)
+				physics.step(scene);
+			auto end = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(end - start).count();
+			const CollisionWorld &collisions = physics.getCollisions();
+			std::cout << "\t" << phase << " : " << ms / ticks << " ms per tick, "
+				<< (static_cast<double>(bodyCount) * ticks) / (ms / 1000.0) / 1e6 << " M bodies/s, then "
+				<< collisions.getPairCount() << " pairs, " << collisions.getContactCount() << " contacts, "
+				<< collisions.getSleepingCount() << " asleep" << std::endl;
+		}
+	}
+
+	std::vector<Pattern> patterns = {
+		{"60 fps", {1.f / 60.f}},
+		{"144 fps", {1.f / 144.f}},
+		{"30 fps", {1.f / 30.f}},
+		{"jitter 5-40 ms", {0.005f, 0.021f, 0.040f, 0.012f, 0.033f, 0.008f}},
+		{"hitch 250 ms", {1.f / 60.f, 1.f / 60.f, 1.f / 60.f, 0.25f}},
+	};
+	bool failed = false;
+	for (const Pattern &pattern : patterns)
+	{
+		PhysicsStepper physics{};
+		uint32_t badAlpha = 0;
+		double elapsed = 0.0;
+		std::vector<glm::vec3> positions = run(pattern, bodyCount, seconds, physics, badAlpha, elapsed);
+
+		//every whole tick of the time fed in was either stepped or dropped by the cap
+		//these frame times add up to whole ticks, when the total lands on a boundary the float accumulator
+		//may be just under it, either side of it is right then
+		const double tick = physics.getTick();
+		const double droppedTicks = std::round(physics.getDroppedTime() / tick);
+		const double expectedTicks = elapsed / tick - droppedTicks;
+		const uint64_t fewest = static_cast<uint64_t>(std::floor(expectedTicks - 1e-3));
+		const uint64_t most = static_cast<uint64_t>(std::floor(expectedTicks + 1e-3));
+		const bool ticksRight = physics.getTotalSteps() >= fewest && physics.getTotalSteps() <= most;
+
+		//the same ticks stepped one by one, advance must not depend on how they were grouped in frames
+		Scene reference;
+		fillScene(reference, bodyCount);
+		PhysicsStepper referencePhysics{};
+		referencePhysics.floorY = 0.5f;
+		for (uint64_t i = 0; i < physics.getTotalSteps(); i++)
+			referencePhysics.step(reference);
+		const bool same = positions == positionsOf(reference, referencePhysics);
+
+		const bool ok = ticksRight && badAlpha == 0 && same;
+		failed = failed || !ok;
+		std::cout << "\t" << pattern.name << " : " << physics.getTotalSteps() << " ticks (" << most << " expected), "
+			<< physics.getDroppedTime() * 1000.f << " ms dropped by the step cap, "
+			<< badAlpha << " frames with alpha out of [0, 1), "
+			<< (same ? "identical to" : "DIFFERS from") << " stepping the ticks directly" << (ok ? "" : " FAILED") << std::endl;
+	}
+
+	//a sleeping stack whose bottom body is removed must wake up, fall by that body height and rest again
+	{
+		Scene scene;
+		Entity floor = scene.createEntity();
+		scene.transforms.get(floor)->translation = {0.f, 0.5f, 0.f};
+		scene.rigidBodies.add(floor).mass = EARTH;
+		ColliderComponent plane{};
+		plane.shape = ColliderShape::Plane;
+		scene.colliders.add(floor, plane);
+		std::vector<Entity> stack;
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			Entity body = scene.createEntity();
+			scene.transforms.get(body)->translation = {0.f, 0.4f - 0.1f * i, 0.f};
+			scene.rigidBodies.add(body).mass = 0.3f;
+			ColliderComponent collider{};
+			collider.shape = i % 2 == 0 ? ColliderShape::Sphere : ColliderShape::Box;
+			collider.center = {0.f, -0.05f, 0.f};
+			collider.halfExtents = glm::vec3(0.045f, 0.05f, 0.045f);
+			collider.radius = 0.045f;
+			scene.colliders.add(body, collider);
+			stack.push_back(body);
+		}
+		PhysicsStepper physics{};
+		physics.floorY = 0.5f;
+		auto heightOf = [&](Entity entity) { return physics.getBodies().positionY[scene.rigidBodies.get(entity)->body]; };
+		for (uint32_t i = 0; i < 720; i++)
+			physics.step(scene);
+		const bool asleepBefore = physics.getCollisions().getSleepingCount() == stack.size();
+		std::vector<float> before;
+		for (size_t i = 1; i < stack.size(); i++)
+			before.push_back(heightOf(stack[i]));
+
+		scene.destroy(stack[0]);
+		scene.flushDestroyed();
+		for (uint32_t i = 0; i < 720; i++)
+			physics.step(scene);
+		//+y is down here, every body left is lower by about the removed one
+		float leastDrop = INFINITY;
+		for (size_t i = 1; i < stack.size(); i++)
+			leastDrop = std::min(leastDrop, heightOf(stack[i]) - before[i - 1]);
+		const bool asleepAfter = physics.getCollisions().getSleepingCount() == stack.size() - 1;
+		const bool ok = asleepBefore && leastDrop > 0.05f && asleepAfter;
+		failed = failed || !ok;
+		std::cout << "\tstack without its bottom : " << (asleepBefore ? "asleep" : "NOT asleep") << " before, every body fell at least "
+			<< leastDrop << ", " << (asleepAfter ? "asleep" : "NOT asleep") << " after" << (ok ? "" : " FAILED") << std::endl;
+	}
+	return failed ? 1 : 0;
+}
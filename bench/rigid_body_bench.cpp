@@ -0,0 +1,99 @@
+//integration throughput of every kernel this cpu supports, and a check that they match the scalar one (exit code 1 if not)
+//build with `make bench_bodies` and run it from the repo root
+
+#include "rigid_body_store.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace wind;
+
+namespace
+{
+	//one body out of 16 is static and one out of 16 asleep, the others start at different heights so some land on the floor and some keep falling
+	void fillStore(RigidBodyStore &store, size_t count)
+	{
+		store.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			store.entities[i] = static_cast<Entity>(i);
+			store.positionX[i] = 0.1f * (i % 100);
+			store.positionY[i] = -0.5f - 0.01f * (i % 997);
+			store.positionZ[i] = 0.1f * (i / 100 % 100);
+			store.velocityX[i] = 0.01f * (i % 7);
+			store.velocityY[i] = 0.f;
+			store.velocityZ[i] = -0.01f * (i % 5);
+			store.accelerationX[i] = 0.f;
+			store.accelerationY[i] = 0.f;
+			store.accelerationZ[i] = 0.1f * (i % 3);
+			store.flags[i] = i % 16 == 0 ? BODY_STATIC : i % 16 == 1 ? BODY_SLEEPING : i % 4 == 2 ? BODY_COLLIDES : 0;
+			store.restTicks[i] = 0;
+			store.inverseMass[i] = store.flags[i] & BODY_STATIC ? 0.f : 1.f / 0.3f;
+		}
+	}
+
+	bool sameState(const RigidBodyStore &a, const RigidBodyStore &b)
+	{
+		const size_t bytes = a.size() * sizeof(float);
+		return std::memcmp(a.positionX.data(), b.positionX.data(), bytes) == 0
+			&& std::memcmp(a.positionY.data(), b.positionY.data(), bytes) == 0
+			&& std::memcmp(a.positionZ.data(), b.positionZ.data(), bytes) == 0
+			&& std::memcmp(a.velocityX.data(), b.velocityX.data(), bytes) == 0
+			&& std::memcmp(a.velocityY.data(), b.velocityY.data(), bytes) == 0
+			&& std::memcmp(a.velocityZ.data(), b.velocityZ.data(), bytes) == 0;
+	}
+}
+
+int main()
+{
+	const float dt = 1.f / 120.f;
+	const float floorY = 0.5f;
+	const IntegrationKernel kernels[] = {IntegrationKernel::Scalar, IntegrationKernel::Sse41, IntegrationKernel::Avx2};
+	std::cout << "runtime pick : " << kernelName(bestIntegrationKernel()) << std::endl;
+	bool failed = false;
+
+	for (size_t count : {size_t(1000), size_t(100000), size_t(1000000)})
+	{
+		//about 100M body updates per measure whatever the count, best of 3
+		const size_t ticks = std::max<size_t>(1, 100000000 / count);
+		RigidBodyStore reference;
+		fillStore(reference, count);
+		for (size_t t = 0; t < 16; t++)
+			integrateBodies(reference, dt, floorY, IntegrationKernel::Scalar);
+
+		std::cout << count << " bodies, " << ticks << " ticks" << std::endl;
+		for (IntegrationKernel kernel : kernels)
+		{
+			if (!isKernelSupported(kernel))
+			{
+				std::cout << "\t" << kernelName(kernel) << " : not supported" << std::endl;
+				continue;
+			}
+			RigidBodyStore check;
+			fillStore(check, count);
+			for (size_t t = 0; t < 16; t++)
+				integrateBodies(check, dt, floorY, kernel);
+
+			double best = 1e30;
+			RigidBodyStore store;
+			for (int run = 0; run < 3; run++)
+			{
+				fillStore(store, count);
+				auto start = std::chrono::high_resolution_clock::now();
+				for (size_t t = 0; t < ticks; t++)
+					integrateBodies(store, dt, floorY, kernel);
+				auto end = std::chrono::high_resolution_clock::now();
+				best = std::min(best, std::chrono::duration<double>(end - start).count());
+			}
+			//the kernels are documented bit identical to the scalar one
+			const bool same = sameState(reference, check);
+			failed = failed || !same;
+			std::cout << "\t" << kernelName(kernel) << " : " << static_cast<double>(count) * ticks / best / 1e6 << " M bodies/s, "
+				<< (same ? "matches scalar" : "DIFFERS from scalar FAILED") << std::endl;
+		}
+	}
+	return failed ? 1 : 0;
+}
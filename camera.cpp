@@ -107,4 +107,27 @@ namespace wind
 		inverseViewMatrix[3][1] = position.y;
 		inverseViewMatrix[3][2] = position.z;
 	}
-}
\ No newline at end of file
+
+	float LveCamera::projectedSize(float worldSize, float distance, float viewportHeight) const
+	{
+		//projection[1][1] is 1 / tan(fovy / 2), the screen spans 2 / projection[1][1] world units at distance 1
+		return worldSize * projectionMatrix[1][1] * 0.5f * viewportHeight / glm::max(distance, 1e-4f);
+	}
+
+	void LveCamera::getFrustumPlanes(glm::vec4 planes[6]) const
+	{
+		//Gribb & Hartmann, rows of projection * view, vulkan clip depth goes from 0 to w
+		glm::mat4 clip = projectionMatrix * viewMatrix;
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+			rows[i] = glm::vec4{clip[0][i], clip[1][i], clip[2][i], clip[3][i]};
+		planes[0] = rows[3] + rows[0];
+		planes[1] = rows[3] - rows[0];
+		planes[2] = rows[3] + rows[1];
+		planes[3] = rows[3] - rows[1];
+		planes[4] = rows[2];
+		planes[5] = rows[3] - rows[2];
+		for (int i = 0; i < 6; i++)
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
@@ -20,6 +20,10 @@ namespace wind
 			const glm::mat4& getView() const { return viewMatrix; }
 			const glm::mat4& getInverseViewMatrix() const { return inverseViewMatrix; }
 			const glm::vec3	 getPosition() const { return glm::vec3(inverseViewMatrix[3]); }
+			//pixels covered by a world space length seen at distance, only meaningful with a perspective projection
+			float projectedSize(float worldSize, float distance, float viewportHeight) const;
+			//world space planes for clip -x, +x, -y, +y, near and far, xyz points inside and is unit length
+			void getFrustumPlanes(glm::vec4 planes[6]) const;
 		private:
 			glm::mat4 projectionMatrix{1.f};
 			glm::mat4 viewMatrix{1.f};
@@ -47,7 +47,7 @@
 
 		void Client::Send(Player &player)
 		{
-			//player.physicalEntity.transform.translation
+			//scene.transforms.get(player.physicalEntity)->translation
 		}
 
 		void Client::Recv()
@@ -0,0 +1,679 @@
+#include "collision.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wind
+{
+	ColliderComponent colliderFromModel(const LveModel &model, float scale, ColliderShape shape)
+	{
+		ColliderComponent collider{};
+		collider.shape = shape;
+		collider.center = model.getBoundsCenter() * scale;
+		collider.halfExtents = glm::abs((model.getBoundsMax() - model.getBoundsMin()) * 0.5f * scale);
+		collider.radius = model.getBoundsRadius() * glm::abs(scale);
+		return collider;
+	}
+
+	namespace
+	{
+		bool endpointLess(float valueA, uint32_t dataA, float valueB, uint32_t dataB)
+		{
+			//at equal values the min end goes first so boxes that just touch still make a pair
+			return valueA < valueB || (valueA == valueB && (dataA & 1) < (dataB & 1));
+		}
+
+		glm::vec3 position(const RigidBodyStore &store, uint32_t i) { return {store.positionX[i], store.positionY[i], store.positionZ[i]}; }
+		glm::vec3 velocity(const RigidBodyStore &store, uint32_t i) { return {store.velocityX[i], store.velocityY[i], store.velocityZ[i]}; }
+
+		//sleeping bodies don't move until they wake up
+		float inverseMass(const RigidBodyStore &store, uint32_t i) { return (store.flags[i] & BODY_FROZEN) ? 0.f : store.inverseMass[i]; }
+
+		void setVelocity(RigidBodyStore &store, uint32_t i, glm::vec3 v)
+		{
+			store.velocityX[i] = v.x;
+			store.velocityY[i] = v.y;
+			store.velocityZ[i] = v.z;
+		}
+
+		void movePosition(RigidBodyStore &store, uint32_t i, glm::vec3 offset)
+		{
+			store.positionX[i] += offset.x;
+			store.positionY[i] += offset.y;
+			store.positionZ[i] += offset.z;
+		}
+
+		uint64_t pairKey(uint32_t a, uint32_t b) { return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b); }
+
+		bool overlaps(const Aabb &a, const Aabb &b)
+		{
+			return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y
+				&& a.min.z <= b.max.z && b.min.z <= a.max.z;
+		}
+	}
+
+	size_t PairTable::home(uint64_t key) const
+	{
+		//murmur3 finalizer, the keys are two small indices and would pile up in the low slots otherwise
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdull;
+		key ^= key >> 33;
+		return static_cast<size_t>(key) & mask;
+	}
+
+	size_t PairTable::slotOf(uint64_t key) const
+	{
+		size_t slot = home(key);
+		while (slots[slot].key != EMPTY && slots[slot].key != key)
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	uint32_t PairTable::find(uint64_t key) const
+	{
+		if (slots.empty())
+			return NONE;
+		const Slot &slot = slots[slotOf(key)];
+		return slot.key == key ? slot.index : NONE;
+	}
+
+	bool PairTable::insert(uint64_t key, uint32_t index)
+	{
+		if ((count + 1) * 2 > slots.size())
+			grow();
+		Slot &slot = slots[slotOf(key)];
+		if (slot.key == key)
+			return false;
+		slot = {key, index};
+		count++;
+		return true;
+	}
+
+	void PairTable::assign(uint64_t key, uint32_t index)
+	{
+		slots[slotOf(key)].index = index;
+	}
+
+	void PairTable::erase(uint64_t key)
+	{
+		if (slots.empty())
+			return;
+		size_t hole = slotOf(key);
+		if (slots[hole].key == EMPTY)
+			return;
+		//the keys after the hole whose home is not between it and them move back into it, probes never cross an empty slot
+		for (size_t next = (hole + 1) & mask; slots[next].key != EMPTY; next = (next + 1) & mask)
+		{
+			const size_t wanted = home(slots[next].key);
+			const bool between = hole <= next ? hole < wanted && wanted <= next : hole < wanted || wanted <= next;
+			if (between)
+				continue;
+			slots[hole] = slots[next];
+			hole = next;
+		}
+		slots[hole].key = EMPTY;
+		count--;
+	}
+
+	void PairTable::clear()
+	{
+		for (Slot &slot : slots)
+			slot.key = EMPTY;
+		count = 0;
+	}
+
+	void PairTable::grow()
+	{
+		std::vector<Slot> old = std::move(slots);
+		slots.assign(std::max<size_t>(old.size() * 2, 64), {EMPTY, 0});
+		mask = slots.size() - 1;
+		count = 0;
+		for (const Slot &slot : old)
+		{
+			if (slot.key != EMPTY)
+				insert(slot.key, slot.index);
+		}
+	}
+
+	void SweepAndPrune::sync(const std::vector<Entity> &bodies, const std::vector<uint8_t> &inside)
+	{
+		if (bodies == entities && inside == lastInside)
+			return;
+
+		//where every entity sits now
+		for (size_t i = 0; i < bodies.size(); i++)
+		{
+			if (!inside[i])
+				continue;
+			const uint32_t slot = entityIndex(bodies[i]);
+			if (slot >= slotBodies.size())
+				slotBodies.resize(slot + 1, NONE);
+			slotBodies[slot] = static_cast<uint32_t>(i);
+		}
+		remap.assign(entities.size(), NONE);
+		added.assign(bodies.size(), 0);
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			const uint32_t slot = entityIndex(entities[i]);
+			if (!lastInside[i] || slot >= slotBodies.size() || slotBodies[slot] == NONE || bodies[slotBodies[slot]] != entities[i])
+				continue;
+			remap[i] = slotBodies[slot];
+			added[remap[i]] = 1; //cleared below, marks the bodies that were already there
+		}
+		for (size_t i = 0; i < bodies.size(); i++)
+		{
+			if (!inside[i])
+				continue;
+			slotBodies[entityIndex(bodies[i])] = NONE;
+			added[i] = !added[i];
+		}
+
+		//endpoints of bodies still there keep their relative order, the others are dropped
+		for (std::vector<Endpoint> &endpoints : axes)
+		{
+			size_t kept = 0;
+			for (const Endpoint &endpoint : endpoints)
+			{
+				const uint32_t body = remap[endpoint.data >> 1];
+				if (body != NONE)
+					endpoints[kept++] = {endpoint.value, (body << 1) | (endpoint.data & 1)};
+			}
+			endpoints.resize(kept);
+			sortedCount = kept;
+			for (size_t i = 0; i < bodies.size(); i++)
+			{
+				if (!added[i])
+					continue;
+				endpoints.push_back({0.f, static_cast<uint32_t>(i) << 1});
+				endpoints.push_back({0.f, (static_cast<uint32_t>(i) << 1) | 1});
+			}
+		}
+
+		//pairs keep their contact cache, a body whose partner went away has lost a pair
+		size_t kept = 0;
+		pairIndices.clear();
+		for (const Pair &pair : pairs)
+		{
+			const uint32_t a = remap[pair.a];
+			const uint32_t b = remap[pair.b];
+			if (a == NONE || b == NONE)
+			{
+				lost.push_back({a, b, pair.cache.tick});
+				continue;
+			}
+			pairs[kept] = {std::min(a, b), std::max(a, b), pair.cache};
+			pairIndices.insert(pairKey(a, b), static_cast<uint32_t>(kept));
+			kept++;
+		}
+		pairs.resize(kept);
+		entities = bodies;
+		lastInside = inside;
+	}
+
+	void SweepAndPrune::update(const std::vector<Aabb> &boxes)
+	{
+		swaps = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (Endpoint &endpoint : axes[axis])
+			{
+				const Aabb &box = boxes[endpoint.data >> 1];
+				endpoint.value = (endpoint.data & 1) ? box.max[axis] : box.min[axis];
+			}
+			sortAxis(axis, boxes);
+		}
+		if (sortedCount < axes[0].size())
+		{
+			//bodies added since the last update, sorted on their own then merged through the scratch (inplace_merge allocates)
+			auto less = [](const Endpoint &a, const Endpoint &b) { return endpointLess(a.value, a.data, b.value, b.data); };
+			for (std::vector<Endpoint> &endpoints : axes)
+			{
+				std::sort(endpoints.begin() + sortedCount, endpoints.end(), less);
+				merged.resize(endpoints.size());
+				std::merge(endpoints.begin(), endpoints.begin() + sortedCount, endpoints.begin() + sortedCount, endpoints.end(), merged.begin(), less);
+				endpoints.swap(merged);
+			}
+			sortedCount = axes[0].size();
+			pairAdded(boxes);
+		}
+	}
+
+	void SweepAndPrune::sortAxis(int axis, const std::vector<Aabb> &boxes)
+	{
+		//every swap of a min and a max is two boxes starting or stopping to overlap on this axis
+		std::vector<Endpoint> &endpoints = axes[axis];
+		for (size_t i = 1; i < sortedCount; i++)
+		{
+			const Endpoint key = endpoints[i];
+			size_t j = i;
+			for (; j > 0 && endpointLess(key.value, key.data, endpoints[j - 1].value, endpoints[j - 1].data); j--)
+			{
+				const Endpoint &passed = endpoints[j - 1];
+				const uint32_t body = key.data >> 1;
+				const uint32_t other = passed.data >> 1;
+				if (!(key.data & 1) && (passed.data & 1))
+				{
+					//a min went below a max, the other axes decide
+					if (overlaps(boxes[body], boxes[other]))
+						addPair(body, other);
+				}
+				else if ((key.data & 1) && !(passed.data & 1))
+				{
+					//a pair that separates on several axes is removed by the first one, most of these swaps are
+					//boxes passing each other far apart and are dropped before the lookup
+					const Aabb &a = boxes[body];
+					const Aabb &b = boxes[other];
+					bool lowerOverlap = true;
+					for (int lower = 0; lower < axis && lowerOverlap; lower++)
+						lowerOverlap = a.min[lower] <= b.max[lower] && b.min[lower] <= a.max[lower];
+					if (lowerOverlap)
+						removePair(body, other);
+				}
+				endpoints[j] = passed;
+			}
+			endpoints[j] = key;
+			swaps += i - j;
+		}
+	}
+
+	void SweepAndPrune::pairAdded(const std::vector<Aabb> &boxes)
+	{
+		//boxes that were already there are only tested against the added ones, their own pairs are known
+		activeOld.clear();
+		activeAdded.clear();
+		activeSlots.resize(boxes.size());
+		for (const Endpoint &endpoint : axes[0])
+		{
+			const uint32_t body = endpoint.data >> 1;
+			std::vector<uint32_t> &active = added[body] ? activeAdded : activeOld;
+			if (endpoint.data & 1)
+			{
+				//swap with the last open box
+				const uint32_t slot = activeSlots[body];
+				active[slot] = active.back();
+				activeSlots[active[slot]] = slot;
+				active.pop_back();
+				continue;
+			}
+			for (uint32_t other : activeAdded)
+			{
+				if (overlaps(boxes[body], boxes[other]))
+					addPair(body, other);
+			}
+			if (added[body])
+			{
+				for (uint32_t other : activeOld)
+				{
+					if (overlaps(boxes[body], boxes[other]))
+						addPair(body, other);
+				}
+			}
+			activeSlots[body] = static_cast<uint32_t>(active.size());
+			active.push_back(body);
+		}
+		std::fill(added.begin(), added.end(), 0);
+	}
+
+	void SweepAndPrune::addPair(uint32_t a, uint32_t b)
+	{
+		//the same pair can come from two axes in one update
+		if (pairIndices.insert(pairKey(a, b), static_cast<uint32_t>(pairs.size())))
+			pairs.push_back({std::min(a, b), std::max(a, b), {}});
+	}
+
+	void SweepAndPrune::removePair(uint32_t a, uint32_t b)
+	{
+		const uint64_t key = pairKey(a, b);
+		const uint32_t index = pairIndices.find(key);
+		if (index == PairTable::NONE)
+			return;
+		pairIndices.erase(key);
+		lost.push_back({a, b, pairs[index].cache.tick});
+		if (index + 1 != pairs.size())
+		{
+			pairs[index] = pairs.back();
+			pairIndices.assign(pairKey(pairs[index].a, pairs[index].b), index);
+		}
+		pairs.pop_back();
+	}
+
+	void CollisionWorld::gather(Scene &scene, RigidBodyStore &store)
+	{
+		const size_t count = store.size();
+		colliders.resize(count);
+		inBroadphase.assign(count, 0);
+		boxes.resize(count);
+		planes.clear();
+		for (size_t i = 0; i < count; i++)
+		{
+			const ColliderComponent *component = scene.colliders.get(store.entities[i]);
+			if (component == nullptr)
+				continue;
+			colliders[i] = {component->shape, component->center, component->halfExtents, component->radius, glm::normalize(component->normal),
+				component->restitution};
+			if (component->shape == ColliderShape::Plane)
+			{
+				if (store.flags[i] & BODY_STATIC)
+					planes.push_back(static_cast<uint32_t>(i));
+			}
+			else
+				inBroadphase[i] = 1;
+		}
+
+		//plane caches follow their plane and body to the new indices, a body whose plane went away while it
+		//touched it wakes up
+		lastPlaneCaches.swap(planeCaches);
+		planeCaches.assign(planes.size() * count, ContactCache{});
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint32_t slot = entityIndex(store.entities[i]);
+			if (slot >= slotBodies.size())
+				slotBodies.resize(slot + 1, UINT32_MAX);
+			slotBodies[slot] = static_cast<uint32_t>(i);
+		}
+		const size_t lastCount = gathered.size();
+		for (size_t lastPlane = 0; lastPlane < planeEntities.size(); lastPlane++)
+		{
+			size_t plane = 0;
+			while (plane < planes.size() && store.entities[planes[plane]] != planeEntities[lastPlane])
+				plane++;
+			for (size_t lastBody = 0; lastBody < lastCount; lastBody++)
+			{
+				const ContactCache &cache = lastPlaneCaches[lastPlane * lastCount + lastBody];
+				const uint32_t slot = entityIndex(gathered[lastBody]);
+				if (cache.tick != tickCount || slot >= slotBodies.size() || slotBodies[slot] == UINT32_MAX
+					|| store.entities[slotBodies[slot]] != gathered[lastBody])
+					continue;
+				const uint32_t body = slotBodies[slot];
+				if (plane == planes.size() || !inBroadphase[body])
+					wake(store, body);
+				else
+					planeCaches[plane * count + body] = cache;
+			}
+		}
+		for (size_t i = 0; i < count; i++)
+			slotBodies[entityIndex(store.entities[i])] = UINT32_MAX;
+		gathered = store.entities;
+		planeEntities.clear();
+		for (uint32_t plane : planes)
+			planeEntities.push_back(store.entities[plane]);
+
+		broadphase.sync(store.entities, inBroadphase);
+	}
+
+	void CollisionWorld::step(RigidBodyStore &store, float dt)
+	{
+		tickCount++;
+		//a body at rest still picks up one tick of gravity before its contacts cancel it
+		wakeSpeed = SLEEP_SPEED + std::abs(GRAVITY) * dt;
+		for (size_t i = 0; i < store.size(); i++)
+		{
+			if (!inBroadphase[i])
+				continue;
+			const Collider &collider = colliders[i];
+			const glm::vec3 center = position(store, static_cast<uint32_t>(i)) + collider.center;
+			//grown by the slop, the narrowphase keeps contacts that are that close to touching
+			const glm::vec3 half = (collider.shape == ColliderShape::Sphere ? glm::vec3(collider.radius) : collider.halfExtents) + SLOP;
+			boxes[i] = {center - half, center + half};
+		}
+		broadphase.update(boxes);
+		//pairs in contact last tick dropped by the update or by the last sync, what rested on a body that went away or moved apart
+		for (const SweepAndPrune::LostPair &pair : broadphase.getLost())
+		{
+			if (pair.tick != tickCount - 1)
+				continue;
+			for (uint32_t body : {pair.body, pair.other})
+			{
+				if (body != SweepAndPrune::NONE)
+					wake(store, body);
+			}
+		}
+		broadphase.clearLost();
+
+		contacts.clear();
+		for (SweepAndPrune::Pair &pair : broadphase.getPairs())
+		{
+			const bool touched = pair.cache.tick == tickCount - 1;
+			if (!collide(store, pair.a, pair.b, pair.cache) && touched)
+			{
+				wake(store, pair.a);
+				wake(store, pair.b);
+			}
+		}
+		for (size_t plane = 0; plane < planes.size(); plane++)
+		{
+			for (size_t i = 0; i < store.size(); i++)
+			{
+				ContactCache &cache = planeCaches[plane * store.size() + i];
+				const bool touched = cache.tick == tickCount - 1;
+				if (inBroadphase[i] && !collide(store, planes[plane], static_cast<uint32_t>(i), cache) && touched)
+					wake(store, static_cast<uint32_t>(i));
+			}
+		}
+		if (!woken.empty())
+			wakeIslands(store);
+		solve(store);
+		updateSleep(store, dt);
+	}
+
+	bool CollisionWorld::collide(RigidBodyStore &store, uint32_t a, uint32_t b, ContactCache &cache)
+	{
+		//resting bodies against each other or against the world don't need anything, their contact holds as it was
+		if ((store.flags[a] & BODY_FROZEN) && (store.flags[b] & BODY_FROZEN))
+		{
+			if (cache.tick != tickCount - 1)
+				return false;
+			cache.tick = tickCount;
+			return true;
+		}
+
+		const Collider *first = &colliders[a];
+		const Collider *second = &colliders[b];
+		//shapes in Sphere, Box, Plane order, the normal is flipped back at the end
+		bool swapped = first->shape > second->shape;
+		if (swapped)
+			std::swap(first, second);
+		const uint32_t firstBody = swapped ? b : a;
+		const uint32_t secondBody = swapped ? a : b;
+		const glm::vec3 centerA = position(store, firstBody) + first->center;
+		const glm::vec3 centerB = position(store, secondBody) + second->center;
+
+		glm::vec3 normal{0.f, -1.f, 0.f}; //from first to second
+		float depth = 0.f;
+		if (first->shape == ColliderShape::Sphere && second->shape == ColliderShape::Sphere)
+		{
+			const glm::vec3 offset = centerB - centerA;
+			const float distance = glm::length(offset);
+			depth = first->radius + second->radius - distance;
+			if (distance > 1e-6f)
+				normal = offset / distance;
+		}
+		else if (first->shape == ColliderShape::Sphere && second->shape == ColliderShape::Box)
+		{
+			const glm::vec3 boxMin = centerB - second->halfExtents;
+			const glm::vec3 boxMax = centerB + second->halfExtents;
+			const glm::vec3 closest = glm::clamp(centerA, boxMin, boxMax);
+			const glm::vec3 offset = closest - centerA;
+			const float distance = glm::length(offset);
+			if (distance > 1e-6f)
+			{
+				depth = first->radius - distance;
+				normal = offset / distance;
+			}
+			else
+			{
+				//center inside the box, out through the closest face
+				const glm::vec3 local = centerA - centerB;
+				const glm::vec3 toFace = second->halfExtents - glm::abs(local);
+				int axis = toFace.x < toFace.y ? (toFace.x < toFace.z ? 0 : 2) : (toFace.y < toFace.z ? 1 : 2);
+				normal = glm::vec3(0.f);
+				normal[axis] = local[axis] < 0.f ? 1.f : -1.f;
+				depth = first->radius + toFace[axis];
+			}
+		}
+		else if (first->shape == ColliderShape::Box && second->shape == ColliderShape::Box)
+		{
+			const glm::vec3 offset = centerB - centerA;
+			const glm::vec3 overlap = first->halfExtents + second->halfExtents - glm::abs(offset);
+			int axis = overlap.x < overlap.y ? (overlap.x < overlap.z ? 0 : 2) : (overlap.y < overlap.z ? 1 : 2);
+			depth = overlap[axis];
+			normal = glm::vec3(0.f);
+			normal[axis] = offset[axis] < 0.f ? -1.f : 1.f;
+			if (overlap.x <= -SLOP || overlap.y <= -SLOP || overlap.z <= -SLOP)
+				return false;
+		}
+		else if (second->shape == ColliderShape::Plane && first->shape != ColliderShape::Plane)
+		{
+			//the plane goes through its body position, first is on its free side when the distance is positive
+			const glm::vec3 planePoint = position(store, secondBody);
+			float distance = glm::dot(second->normal, centerA - planePoint);
+			distance -= first->shape == ColliderShape::Sphere ? first->radius : glm::dot(glm::abs(second->normal), first->halfExtents);
+			depth = -distance;
+			normal = -second->normal;
+		}
+		//bodies just touching still get a contact, a body held exactly at the floor by the kernel clamp must still carry the ones above
+		if (depth <= -SLOP)
+			return false;
+		if (swapped)
+			normal = -normal;
+
+		//a sleeping body wakes up when it is hit, an awake body only resting on it leans on it like on the floor
+		if (-glm::dot(velocity(store, b) - velocity(store, a), normal) > wakeSpeed)
+		{
+			wake(store, a);
+			wake(store, b);
+		}
+		contacts.push_back({a, b, normal, depth, 0.f, 0.f, &cache});
+		return true;
+	}
+
+	void CollisionWorld::wake(RigidBodyStore &store, uint32_t body)
+	{
+		if (!(store.flags[body] & BODY_SLEEPING))
+			return;
+		store.flags[body] &= ~BODY_SLEEPING;
+		store.restTicks[body] = 0;
+		woken.push_back(body);
+	}
+
+	void CollisionWorld::wakeIslands(RigidBodyStore &store)
+	{
+		//bodies touching this tick or the last one, by body, only built when something woke up
+		const size_t count = store.size();
+		const std::vector<SweepAndPrune::Pair> &pairs = broadphase.getPairs();
+		neighbourStart.assign(count + 1, 0);
+		for (const SweepAndPrune::Pair &pair : pairs)
+		{
+			if (pair.cache.tick + 1 < tickCount)
+				continue;
+			neighbourStart[pair.a + 1]++;
+			neighbourStart[pair.b + 1]++;
+		}
+		for (size_t i = 0; i < count; i++)
+			neighbourStart[i + 1] += neighbourStart[i];
+		neighbours.resize(neighbourStart[count]);
+		neighbourCursor.assign(neighbourStart.begin(), neighbourStart.end() - 1);
+		for (const SweepAndPrune::Pair &pair : pairs)
+		{
+			if (pair.cache.tick + 1 < tickCount)
+				continue;
+			neighbours[neighbourCursor[pair.a]++] = pair.b;
+			neighbours[neighbourCursor[pair.b]++] = pair.a;
+		}
+
+		//awake neighbours are left alone, they wake the ones behind them when they move away
+		while (!woken.empty())
+		{
+			const uint32_t body = woken.back();
+			woken.pop_back();
+			for (uint32_t i = neighbourStart[body]; i < neighbourStart[body + 1]; i++)
+				wake(store, neighbours[i]);
+		}
+	}
+
+	void CollisionWorld::solve(RigidBodyStore &store)
+	{
+		//every contact starts from the impulse it ended with last tick, a resting stack is then already
+		//close to balanced and the iterations only fix what changed
+		for (Contact &contact : contacts)
+		{
+			const float inverseA = inverseMass(store, contact.a);
+			const float inverseB = inverseMass(store, contact.b);
+			const float closing = glm::dot(velocity(store, contact.b) - velocity(store, contact.a), contact.normal);
+			const bool touched = contact.cache->tick == tickCount - 1;
+			contact.impulse = touched ? contact.cache->impulse : 0.f;
+			//only new contacts bounce, off the speed before any impulse, slow impacts and resting contacts just stop
+			contact.target = !touched && -closing > RESTITUTION_SPEED
+				? -closing * std::max(colliders[contact.a].restitution, colliders[contact.b].restitution) : 0.f;
+			if (contact.impulse > 0.f && inverseA + inverseB > 0.f)
+			{
+				setVelocity(store, contact.a, velocity(store, contact.a) - contact.normal * (contact.impulse * inverseA));
+				setVelocity(store, contact.b, velocity(store, contact.b) + contact.normal * (contact.impulse * inverseB));
+			}
+		}
+
+		//impulses along the normal until the bodies stop closing in, the total of a contact never pulls
+		for (uint32_t iteration = 0; iteration < SOLVER_ITERATIONS; iteration++)
+		{
+			for (Contact &contact : contacts)
+			{
+				const float inverseA = inverseMass(store, contact.a);
+				const float inverseB = inverseMass(store, contact.b);
+				if (inverseA + inverseB <= 0.f)
+					continue;
+				const glm::vec3 velocityA = velocity(store, contact.a);
+				const glm::vec3 velocityB = velocity(store, contact.b);
+				const float closing = glm::dot(velocityB - velocityA, contact.normal);
+				const float total = std::max(contact.impulse + (contact.target - closing) / (inverseA + inverseB), 0.f);
+				const float impulse = total - contact.impulse;
+				contact.impulse = total;
+				setVelocity(store, contact.a, velocityA - contact.normal * (impulse * inverseA));
+				setVelocity(store, contact.b, velocityB + contact.normal * (impulse * inverseB));
+			}
+		}
+		for (const Contact &contact : contacts)
+			*contact.cache = {contact.impulse, tickCount};
+
+		//what is left of the penetration, spread by inverse mass
+		for (const Contact &contact : contacts)
+		{
+			const float inverseA = inverseMass(store, contact.a);
+			const float inverseB = inverseMass(store, contact.b);
+			if (inverseA + inverseB <= 0.f || contact.depth <= SLOP)
+				continue;
+			const glm::vec3 correction = contact.normal * ((contact.depth - SLOP) * CORRECTION / (inverseA + inverseB));
+			movePosition(store, contact.a, -correction * inverseA);
+			movePosition(store, contact.b, correction * inverseB);
+		}
+	}
+
+	void CollisionWorld::updateSleep(RigidBodyStore &store, float dt)
+	{
+		const float damping = std::max(0.f, 1.f - LINEAR_DAMPING * dt);
+		sleepingCount = 0;
+		for (size_t i = 0; i < store.size(); i++)
+		{
+			if (store.flags[i] & BODY_STATIC)
+				continue;
+			if (store.flags[i] & BODY_SLEEPING)
+			{
+				sleepingCount++;
+				continue;
+			}
+			store.velocityX[i] *= damping;
+			store.velocityZ[i] *= damping;
+			const glm::vec3 v = velocity(store, static_cast<uint32_t>(i));
+			if (glm::dot(v, v) >= SLEEP_SPEED * SLEEP_SPEED || store.accelerationX[i] != 0.f || store.accelerationY[i] != 0.f || store.accelerationZ[i] != 0.f)
+			{
+				store.restTicks[i] = 0;
+				continue;
+			}
+			if (++store.restTicks[i] >= SLEEP_TICKS)
+			{
+				store.flags[i] |= BODY_SLEEPING;
+				setVelocity(store, static_cast<uint32_t>(i), glm::vec3(0.f));
+				sleepingCount++;
+			}
+		}
+	}
+}
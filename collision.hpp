@@ -0,0 +1,201 @@
+#pragma once
+
+#include "model.hpp"
+#include "rigid_body_store.hpp"
+#include "scene.hpp"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace wind
+{
+	//collider around the model object space aabb (the box itself or the sphere around it) scaled like its transform
+	ColliderComponent colliderFromModel(const LveModel &model, float scale, ColliderShape shape = ColliderShape::Box);
+
+	struct Aabb
+	{
+		glm::vec3	min{0.f};
+		glm::vec3	max{0.f};
+	};
+
+	//what the solver kept of the contact of two bodies, the impulse warm starts the next tick if they still touch
+	struct ContactCache
+	{
+		float		impulse = 0.f;
+		uint32_t	tick = 0; //CollisionWorld tick of the last contact, 0 never touched
+	};
+
+	//flat open addressing map from a pair key to its index in the pair list, linear probing and backward shift erase
+	//it only grows (load factor under 0.5), once it held the peak pair count adding and removing pairs does not allocate
+	class PairTable
+	{
+		public:
+			static constexpr uint32_t NONE = UINT32_MAX;
+
+			uint32_t find(uint64_t key) const; //NONE when it is not there
+			bool insert(uint64_t key, uint32_t index); //false when the key is already there
+			void assign(uint64_t key, uint32_t index); //the key must be there
+			void erase(uint64_t key);
+			void clear(); //keeps the capacity
+
+		private:
+			struct Slot
+			{
+				uint64_t	key;
+				uint32_t	index;
+			};
+			static constexpr uint64_t EMPTY = UINT64_MAX; //no pair of two bodies has that key
+
+			std::vector<Slot>	slots;
+			size_t				mask = 0;
+			size_t				count = 0;
+
+			size_t home(uint64_t key) const;
+			size_t slotOf(uint64_t key) const; //the slot holding key or the empty one ending its probe
+			void grow();
+	};
+
+	//incremental sweep and prune : the min and max of every box stay in sorted endpoint arrays (one per axis) from tick to tick,
+	//bodies move little between two ticks so an insertion sort puts them back in order in close to linear time,
+	//and the pairs only change where a min and a max crossed, bodies at rest cost nothing past the sorting pass
+	class SweepAndPrune
+	{
+		public:
+			static constexpr uint32_t NONE = UINT32_MAX;
+
+			struct Pair
+			{
+				uint32_t		a; //lower body index
+				uint32_t		b;
+				ContactCache	cache; //follows the pair through syncs, starts empty
+			};
+			struct LostPair
+			{
+				uint32_t	body; //either is NONE for a body that went away
+				uint32_t	other;
+				uint32_t	tick; //of the cache, the last contact
+			};
+
+			//the bodies changed (index i is entities[i], only the inside ones take part), endpoints and pairs of the bodies
+			//still there are kept and the new ones are merged in at the next update
+			void sync(const std::vector<Entity> &bodies, const std::vector<uint8_t> &inside);
+			//brings the pairs up to date with the boxes, indexed like the bodies of the last sync
+			void update(const std::vector<Aabb> &boxes);
+			//every pair of boxes that overlap
+			const std::vector<Pair> &getPairs() const { return pairs; }
+			std::vector<Pair> &getPairs() { return pairs; } //only the caches are to be written
+			//pairs removed in the syncs and updates since clearLost, those dropped with a removed body included
+			const std::vector<LostPair> &getLost() const { return lost; }
+			void clearLost() { lost.clear(); }
+			size_t getSwaps() const { return swaps; } //endpoint moves of the last insertion sorts
+
+		private:
+			struct Endpoint
+			{
+				float		value;
+				uint32_t	data; //body << 1, low bit set for the max end
+			};
+
+			std::array<std::vector<Endpoint>, 3> axes;
+			size_t					sortedCount = 0; //endpoints in order since the last update, the ones after were just added
+			std::vector<Entity>		entities; //body index to entity at the last sync
+			std::vector<uint8_t>	lastInside;
+			std::vector<uint8_t>	added; //bodies appended by the last sync, not paired yet
+			std::vector<uint32_t>	slotBodies; //entity slot to body index, only used during sync
+			std::vector<uint32_t>	remap; //body index before the sync to after it
+			std::vector<Pair>		pairs;
+			PairTable				pairIndices; //pair key to its index in pairs
+			std::vector<LostPair>	lost;
+			std::vector<Endpoint>	merged; //scratch of the merge of added endpoints
+			std::vector<uint32_t>	activeOld; //boxes open at the current endpoint while pairing the added bodies
+			std::vector<uint32_t>	activeAdded;
+			std::vector<uint32_t>	activeSlots; //body to its index in its active list
+			size_t					swaps = 0;
+
+			void addPair(uint32_t a, uint32_t b);
+			void removePair(uint32_t a, uint32_t b);
+			void sortAxis(int axis, const std::vector<Aabb> &boxes);
+			//pairs of the added bodies, one sweep on x once their endpoints are in order
+			void pairAdded(const std::vector<Aabb> &boxes);
+	};
+
+	//contact of two bodies of the store, normal goes from a to b
+	struct Contact
+	{
+		uint32_t		a;
+		uint32_t		b;
+		glm::vec3		normal;
+		float			depth;
+		float			impulse; //along the normal, summed over the solver iterations
+		float			target; //separating speed after the impulse, from restitution
+		ContactCache	*cache; //of the broadphase pair or the plane, lives until the next broadphase update
+	};
+
+	//collisions of the rigid bodies, run by PhysicsStepper after each integration tick
+	//boxes and spheres go through the sweep and prune, planes are few and tested against every body
+	//contacts are solved with impulses (velocities) then pushed apart (positions),
+	//bodies that stay slow long enough fall asleep, they don't move and are left out until something hits them
+	//or they lose a pair or a contact, a body waking up wakes the sleeping ones touching it, and theirs (islands)
+	class CollisionWorld
+	{
+		public:
+			static constexpr uint32_t	SOLVER_ITERATIONS = 4;
+			static constexpr float		SLOP = 0.005f; //penetration left alone so resting contacts don't jitter
+			static constexpr float		CORRECTION = 0.6f; //part of the remaining penetration removed per tick
+			static constexpr float		RESTITUTION_SPEED = 0.5f; //slower impacts don't bounce, or nothing would come to rest
+			static constexpr float		LINEAR_DAMPING = 0.5f; //per second on x and z, there is no friction otherwise
+			static constexpr float		SLEEP_SPEED = 0.05f;
+			static constexpr uint32_t	SLEEP_TICKS = 60;
+
+			//colliders of the store bodies, again whenever bodies or colliders were added or removed
+			void gather(Scene &scene, RigidBodyStore &store);
+			void step(RigidBodyStore &store, float dt);
+
+			uint32_t getPairCount() const { return static_cast<uint32_t>(broadphase.getPairs().size()); } //last tick broadphase pairs
+			uint32_t getContactCount() const { return static_cast<uint32_t>(contacts.size()); }
+			uint32_t getSleepingCount() const { return sleepingCount; }
+
+		private:
+			struct Collider
+			{
+				ColliderShape	shape;
+				glm::vec3		center;
+				glm::vec3		halfExtents;
+				float			radius;
+				glm::vec3		normal;
+				float			restitution;
+			};
+
+			std::vector<Collider>	colliders; //store order
+			std::vector<uint8_t>	inBroadphase; //has a sphere or box collider
+			std::vector<uint32_t>	planes; //bodies with a plane collider
+			std::vector<Aabb>		boxes;
+			std::vector<Contact>	contacts;
+			std::vector<ContactCache> planeCaches; //plane p against body i at p * body count + i
+			SweepAndPrune			broadphase;
+			uint32_t				tickCount = 1;
+			uint32_t				sleepingCount = 0;
+			float					wakeSpeed = 0.f; //closing speed that wakes a sleeping body
+			std::vector<uint32_t>	woken; //bodies woken this tick, their sleeping neighbours are next
+			//as of the last gather, so the plane caches can follow their bodies
+			std::vector<Entity>		gathered;
+			std::vector<Entity>		planeEntities;
+			std::vector<ContactCache> lastPlaneCaches;
+			std::vector<uint32_t>	slotBodies; //entity slot to body index, only used during gather
+			//bodies touching each body, built on the ticks something woke up
+			std::vector<uint32_t>	neighbourStart;
+			std::vector<uint32_t>	neighbourCursor;
+			std::vector<uint32_t>	neighbours;
+
+			//appends the contact of bodies a and b if they touch, wakes a sleeping one hit hard enough
+			//returns whether they touch, two frozen bodies that touched last tick still do
+			bool collide(RigidBodyStore &store, uint32_t a, uint32_t b, ContactCache &cache);
+			void solve(RigidBodyStore &store);
+			void updateSleep(RigidBodyStore &store, float dt);
+			void wake(RigidBodyStore &store, uint32_t body);
+			//wakes every sleeping body touching a woken one, and so on
+			void wakeIslands(RigidBodyStore &store);
+	};
+}
@@ -1,4 +1,6 @@
 /usr/bin/glslc shaders/shader.vert -o shaders/shader.vert.spv
+/usr/bin/glslc shaders/shader_compact.vert -o shaders/shader_compact.vert.spv
 /usr/bin/glslc shaders/frag.frag -o shaders/frag.frag.spv
+/usr/bin/glslc shaders/cull.comp -o shaders/cull.comp.spv
 /usr/bin/glslc shaders/point_light.vert -o shaders/point_light.vert.spv
-/usr/bin/glslc shaders/point_light.frag -o shaders/point_light.frag.spv
\ No newline at end of file
+/usr/bin/glslc shaders/point_light.frag -o shaders/point_light.frag.spv
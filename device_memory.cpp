@@ -0,0 +1,190 @@
+#include "device_memory.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace wind
+{
+	DeviceMemoryAllocator::DeviceMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+		: device{device}, blockSize{blockSize}
+	{
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		nonCoherentAtomSize = std::max<VkDeviceSize>(1, properties.limits.nonCoherentAtomSize);
+
+		heapStats.resize(memoryProperties.memoryHeapCount);
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+		{
+			heapStats[i].heapSize = memoryProperties.memoryHeaps[i].size;
+			heapStats[i].flags = memoryProperties.memoryHeaps[i].flags;
+		}
+	}
+
+	DeviceMemoryAllocator::~DeviceMemoryAllocator()
+	{
+		for (uint32_t p = 0; p < VK_MAX_MEMORY_TYPES * 2; p++)
+		{
+			for (auto &block : pools[p].blocks)
+			{
+				if (!block)
+					continue;
+				if (!block->ranges.isEmpty())
+					std::cerr << "device memory leak : " << block->ranges.getAllocationCount() << " allocations in memory type " << p / 2 << std::endl;
+				freeMemory(block->memory, block->ranges.getCapacity(), p / 2);
+			}
+		}
+	}
+
+	//small heaps (the 256MB host visible device local one on many gpus) get smaller blocks
+	VkDeviceSize DeviceMemoryAllocator::blockSizeFor(uint32_t memoryType) const
+	{
+		VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+		return std::min(blockSize, std::max<VkDeviceSize>(heapSize / 8, 1024 * 1024));
+	}
+
+	VkDeviceMemory DeviceMemoryAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryType, void **mapped)
+	{
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+			throw std::runtime_error("failed to allocate device memory!");
+
+		*mapped = nullptr;
+		if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS)
+				throw std::runtime_error("failed to map device memory!");
+		}
+
+		HeapStats &stats = heapStats[memoryProperties.memoryTypes[memoryType].heapIndex];
+		stats.reserved += size;
+		stats.memoryObjects++;
+		return memory;
+	}
+
+	void DeviceMemoryAllocator::freeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType)
+	{
+		vkFreeMemory(device, memory, nullptr); //implicitly unmaps
+		HeapStats &stats = heapStats[memoryProperties.memoryTypes[memoryType].heapIndex];
+		stats.reserved -= size;
+		stats.memoryObjects--;
+	}
+
+	DeviceAllocation DeviceMemoryAllocator::allocate(const VkMemoryRequirements &requirements, uint32_t memoryType, bool linear)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+		HeapStats &stats = heapStats[memoryProperties.memoryTypes[memoryType].heapIndex];
+		VkDeviceSize alignment = requirements.alignment;
+		//non coherent memory is flushed in atoms, two allocations must not share one
+		if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+			alignment = std::max(alignment, nonCoherentAtomSize);
+		VkDeviceSize size = (requirements.size + alignment - 1) / alignment * alignment;
+
+		DeviceAllocation allocation{};
+		allocation.size = size;
+		const VkDeviceSize poolBlockSize = blockSizeFor(memoryType);
+		if (size > poolBlockSize / 2) //would waste most of a block, give it its own memory
+		{
+			allocation.memory = allocateMemory(size, memoryType, &allocation.mapped);
+			allocation.pool = UINT32_MAX;
+			allocation.block = memoryType;
+			stats.used += size;
+			stats.allocations++;
+			return allocation;
+		}
+
+		uint32_t poolIndex = memoryType * 2 + (linear ? 1 : 0);
+		Pool &pool = pools[poolIndex];
+		uint32_t blockIndex = UINT32_MAX;
+		for (uint32_t b = 0; b < pool.blocks.size(); b++)
+		{
+			if (pool.blocks[b] && pool.blocks[b]->ranges.allocate(size, alignment, allocation.offset))
+			{
+				blockIndex = b;
+				break;
+			}
+		}
+		if (blockIndex == UINT32_MAX)
+		{
+			auto block = std::make_unique<Block>(poolBlockSize);
+			block->memory = allocateMemory(poolBlockSize, memoryType, &block->mapped);
+			block->ranges.allocate(size, alignment, allocation.offset);
+
+			auto slot = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+			blockIndex = static_cast<uint32_t>(slot - pool.blocks.begin());
+			if (slot == pool.blocks.end())
+				pool.blocks.push_back(std::move(block));
+			else
+				*slot = std::move(block);
+			pool.liveBlocks++;
+		}
+
+		Block &block = *pool.blocks[blockIndex];
+		allocation.memory = block.memory;
+		allocation.pool = poolIndex;
+		allocation.block = blockIndex;
+		if (block.mapped != nullptr)
+			allocation.mapped = static_cast<char *>(block.mapped) + allocation.offset;
+		stats.used += size;
+		stats.allocations++;
+		return allocation;
+	}
+
+	void DeviceMemoryAllocator::free(DeviceAllocation &allocation)
+	{
+		if (allocation.memory == VK_NULL_HANDLE)
+			return;
+		std::lock_guard<std::mutex> lock(mutex);
+
+		uint32_t memoryType = allocation.pool == UINT32_MAX ? allocation.block : allocation.pool / 2;
+		HeapStats &stats = heapStats[memoryProperties.memoryTypes[memoryType].heapIndex];
+		stats.used -= allocation.size;
+		stats.allocations--;
+
+		if (allocation.pool == UINT32_MAX)
+			freeMemory(allocation.memory, allocation.size, memoryType);
+		else
+		{
+			Pool &pool = pools[allocation.pool];
+			std::unique_ptr<Block> &block = pool.blocks[allocation.block];
+			block->ranges.free(allocation.offset);
+			//keep the last block of a pool around, freeing and reallocating it every frame would be worse than holding it
+			if (block->ranges.isEmpty() && pool.liveBlocks > 1)
+			{
+				freeMemory(block->memory, block->ranges.getCapacity(), memoryType);
+				block.reset();
+				pool.liveBlocks--;
+			}
+		}
+		allocation = DeviceAllocation{};
+	}
+
+	std::vector<DeviceMemoryAllocator::HeapStats> DeviceMemoryAllocator::getHeapStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return heapStats;
+	}
+
+	void DeviceMemoryAllocator::printStats()
+	{
+		std::vector<HeapStats> stats = getHeapStats();
+		std::cout << "device memory :" << std::endl;
+		for (size_t i = 0; i < stats.size(); i++)
+		{
+			if (stats[i].memoryObjects == 0)
+				continue;
+			std::cout << "  heap " << i << ((stats[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : " (host)")
+				<< " : " << stats[i].used / 1024 << " KB used in " << stats[i].allocations << " allocations, "
+				<< stats[i].reserved / 1024 << " KB reserved in " << stats[i].memoryObjects << " vkAllocateMemory, heap is "
+				<< stats[i].heapSize / (1024 * 1024) << " MB" << std::endl;
+		}
+	}
+}
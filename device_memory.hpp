@@ -0,0 +1,88 @@
+#pragma once
+
+#include "range_allocator.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace wind
+{
+	//a slice of a VkDeviceMemory, bind the resource at memory + offset
+	struct DeviceAllocation
+	{
+		VkDeviceMemory	memory = VK_NULL_HANDLE;
+		VkDeviceSize	offset = 0;
+		VkDeviceSize	size = 0;
+		void			*mapped = nullptr; //already points at offset, only set for host visible memory
+		uint32_t		pool = UINT32_MAX; //UINT32_MAX is a dedicated VkDeviceMemory
+		uint32_t		block = 0;
+	};
+
+	//drivers cap vkAllocateMemory at a few thousand live allocations and each one is slow,
+	//so memory is taken in large blocks per memory type and placed inside them with a RangeAllocator
+	//buffers and optimal tiling images never share a block, that way bufferImageGranularity can't bite
+	//host visible blocks are mapped once for their whole life, never call vkMapMemory on an allocation
+	//thread safe, the streaming thread allocates too
+	class DeviceMemoryAllocator
+	{
+		public:
+			static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+			struct HeapStats
+			{
+				VkDeviceSize	heapSize = 0;
+				VkMemoryHeapFlags flags = 0;
+				VkDeviceSize	reserved = 0; //bytes taken from the driver
+				VkDeviceSize	used = 0; //bytes handed out
+				uint32_t		memoryObjects = 0; //live vkAllocateMemory
+				uint32_t		allocations = 0;
+			};
+
+			DeviceMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+			~DeviceMemoryAllocator();
+
+			DeviceMemoryAllocator(const DeviceMemoryAllocator &) = delete;
+			DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator &) = delete;
+
+			//linear is true for buffers and linear images, false for optimal tiling images
+			DeviceAllocation allocate(const VkMemoryRequirements &requirements, uint32_t memoryType, bool linear);
+			void free(DeviceAllocation &allocation);
+
+			std::vector<HeapStats> getHeapStats();
+			void printStats();
+
+		private:
+			struct Block
+			{
+				VkDeviceMemory	memory = VK_NULL_HANDLE;
+				void			*mapped = nullptr;
+				RangeAllocator	ranges;
+
+				explicit Block(VkDeviceSize size) : ranges{size} {}
+			};
+
+			struct Pool
+			{
+				std::vector<std::unique_ptr<Block>> blocks; //freed blocks leave a null slot so indices stay valid
+				uint32_t liveBlocks = 0;
+			};
+
+			VkDevice			device;
+			VkDeviceSize		blockSize;
+			VkDeviceSize		nonCoherentAtomSize;
+			VkPhysicalDeviceMemoryProperties memoryProperties;
+
+			std::mutex			mutex;
+			Pool				pools[VK_MAX_MEMORY_TYPES * 2]; //memoryType * 2 + linear
+			std::vector<HeapStats> heapStats;
+
+			VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryType, void **mapped);
+			void freeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType);
+			VkDeviceSize blockSizeFor(uint32_t memoryType) const;
+	};
+}
@@ -59,10 +59,13 @@ EngineDevice::EngineDevice(Window &window) : window{window}
 	pickPhysicalDevice(); //chooses physical device to link to
 	createLogicalDevice();//binds our physical device to a logical device with specifics infos
 	createCommandPool();//bind command pool with our newly created logical device
+	allocator_ = std::make_unique<DeviceMemoryAllocator>(physicalDevice, device_);
 }
 
 EngineDevice::~EngineDevice()
 {
+	allocator_.reset();
+	vkDestroyCommandPool(device_, transferCommandPool, nullptr);
 	vkDestroyCommandPool(device_, commandPool, nullptr);
 	vkDestroyDevice(device_, nullptr);
 
@@ -146,22 +149,34 @@ void EngineDevice::pickPhysicalDevice()
 void EngineDevice::createLogicalDevice()
 {
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+	queueFamilies_ = indices;
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+	std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily, indices.transferFamily};
 
-	float queuePriority = 1.0f;
+	float queuePriorities[2] = {1.0f, 0.5f}; //the second graphics queue only carries uploads
 	for (uint32_t queueFamily : uniqueQueueFamilies) {
 		VkDeviceQueueCreateInfo queueCreateInfo = {};
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 		queueCreateInfo.queueFamilyIndex = queueFamily;
-		queueCreateInfo.queueCount = 1;
-		queueCreateInfo.pQueuePriorities = &queuePriority;
+		queueCreateInfo.queueCount = queueFamily == indices.transferFamily ? indices.transferQueueIndex + 1 : 1;
+		queueCreateInfo.pQueuePriorities = queuePriorities;
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect; //optional, without it indirect draws are issued one by one
+	deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance; //optional, gpu culling needs it
+	enabledFeatures = deviceFeatures;
+
+	std::vector<const char *> extensions = deviceExtensions;
+	const bool drawIndirectCount = checkDeviceExtensionSupport(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	if (drawIndirectCount)
+		extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
 
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -170,8 +185,8 @@ void EngineDevice::createLogicalDevice()
 	createInfo.pQueueCreateInfos = queueCreateInfos.data(); //each queue family needs its own p queue create info
 
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	createInfo.ppEnabledExtensionNames = extensions.data();
 
 	if (enableValidationLayers) //not really necessary anymore because device specific validation layers have been deprecated
 	{
@@ -190,9 +205,21 @@ void EngineDevice::createLogicalDevice()
 
 	if (indices.graphicsFamily == indices.presentFamily)
 		std::cout << "Graphics and present family in same queue" << std::endl;
+	if (drawIndirectCount)
+	{
+		cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+			vkGetDeviceProcAddr(device_, "vkCmdDrawIndexedIndirectCountKHR"));
+	}
 
 	vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_); //fills queues
 	vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+	vkGetDeviceQueue(device_, indices.transferFamily, indices.transferQueueIndex, &transferQueue_);
+	if (indices.transferFamily != indices.graphicsFamily)
+		std::cout << "transfer queue: dedicated family " << indices.transferFamily << std::endl;
+	else if (indices.transferQueueIndex != 0)
+		std::cout << "transfer queue: second queue of the graphics family" << std::endl;
+	else
+		std::cout << "transfer queue: shared with graphics" << std::endl;
 }
 
 void EngineDevice::createCommandPool()
@@ -209,6 +236,12 @@ void EngineDevice::createCommandPool()
 	{
 		throw std::runtime_error("failed to create command pool!");
 	}
+
+	poolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily;
+	if (vkCreateCommandPool(device_, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create transfer command pool!");
+	}
 }
 
 void EngineDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
@@ -350,6 +383,20 @@ bool EngineDevice::checkDeviceExtensionSupport(VkPhysicalDevice device)
 	return requiredExtensions.empty();//if all required ext are availbe then the string will be empty returning true
 }
 
+bool EngineDevice::checkDeviceExtensionSupport(VkPhysicalDevice device, const char *extension)
+{
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+	for (const auto &available : availableExtensions)
+	{
+		if (strcmp(available.extensionName, extension) == 0)
+			return true;
+	}
+	return false;
+}
+
 QueueFamilyIndices EngineDevice::findQueueFamilies(VkPhysicalDevice device)
 {
 	QueueFamilyIndices indices;
@@ -367,6 +414,7 @@ QueueFamilyIndices EngineDevice::findQueueFamilies(VkPhysicalDevice device)
 		{
 			indices.graphicsFamily = i;
 			indices.graphicsFamilyHasValue = true;
+			indices.graphicsFamilyHasCompute = (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
 		}
 		VkBool32 presentSupport = false;
 		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
@@ -380,6 +428,25 @@ QueueFamilyIndices EngineDevice::findQueueFamilies(VkPhysicalDevice device)
 
 		i++;
 	}
+	if (!indices.graphicsFamilyHasValue)
+		return indices;
+
+	//copies go to a family that can't draw or dispatch when there is one, that is the dma engine on discrete gpus
+	//transfer support is implied by graphics or compute even when the bit is not set
+	indices.transferFamily = indices.graphicsFamily;
+	indices.transferQueueIndex = 0;
+	bool found = false;
+	for (uint32_t f = 0; f < queueFamilyCount && !found; f++)
+	{
+		VkQueueFlags flags = queueFamilies[f].queueFlags;
+		if (queueFamilies[f].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			indices.transferFamily = f;
+			found = true;
+		}
+	}
+	if (!found && queueFamilies[indices.graphicsFamily].queueCount > 1)
+		indices.transferQueueIndex = 1;
 
 	return indices; //when we get a fam queue with grapichbit on and that spport surfacekhr we return its indices
 }
@@ -454,7 +521,7 @@ void EngineDevice::createBuffer(
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkBuffer &buffer,
-		VkDeviceMemory &bufferMemory)
+		DeviceAllocation &bufferMemory)
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -470,16 +537,8 @@ void EngineDevice::createBuffer(
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate vertex buffer memory!");
-	}
-
-	vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+	bufferMemory = allocator_->allocate(memRequirements, findMemoryType(memRequirements.memoryTypeBits, properties), true);
+	vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
 VkCommandBuffer EngineDevice::beginSingleTimeCommands()
@@ -510,15 +569,154 @@ void EngineDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer)
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
 
-	vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue_);
+	{
+		std::lock_guard<std::mutex> lock(queueMutex_);
+		vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
+		vkQueueWaitIdle(graphicsQueue_);
+	}
 
 	vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
 
+void EngineDevice::waitIdle()
+{
+	std::lock_guard<std::mutex> lock(queueMutex_);
+	vkDeviceWaitIdle(device_);
+}
+
+VkCommandBuffer EngineDevice::beginTransferCommands()
+{
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = transferCommandPool;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	return commandBuffer;
+}
+
+void EngineDevice::recordOwnershipTransfer(VkCommandBuffer release, VkCommandBuffer acquire,
+		std::vector<VkBufferMemoryBarrier> &bufferBarriers, std::vector<VkImageMemoryBarrier> &imageBarriers)
+{
+	//everything the graphics queue may read an upload with
+	const VkPipelineStageFlags consumerStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	const VkAccessFlags consumerAccess = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	if (bufferBarriers.empty() && imageBarriers.empty())
+		return;
+
+	//one family : nothing to hand over, the acquire side is a plain memory barrier (and the layout change)
+	const bool sameFamily = queueFamilies_.transferFamily == queueFamilies_.graphicsFamily;
+	for (VkBufferMemoryBarrier &barrier : bufferBarriers)
+	{
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED : queueFamilies_.transferFamily;
+		barrier.dstQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED : queueFamilies_.graphicsFamily;
+	}
+	for (VkImageMemoryBarrier &barrier : imageBarriers)
+	{
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED : queueFamilies_.transferFamily;
+		barrier.dstQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED : queueFamilies_.graphicsFamily;
+	}
+
+	if (!sameFamily)
+	{
+		//release : make the copies available, the destination access is ignored on this side
+		for (VkBufferMemoryBarrier &barrier : bufferBarriers)
+		{
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+		}
+		for (VkImageMemoryBarrier &barrier : imageBarriers)
+		{
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+		}
+		vkCmdPipelineBarrier(release, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+
+	//acquire : the semaphore is waited at the transfer stage, chain from there to the readers
+	for (VkBufferMemoryBarrier &barrier : bufferBarriers)
+	{
+		barrier.srcAccessMask = sameFamily ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+		barrier.dstAccessMask = consumerAccess;
+	}
+	for (VkImageMemoryBarrier &barrier : imageBarriers)
+	{
+		barrier.srcAccessMask = sameFamily ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	}
+	vkCmdPipelineBarrier(acquire, VK_PIPELINE_STAGE_TRANSFER_BIT, consumerStages, 0,
+		0, nullptr,
+		static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+		static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+void EngineDevice::endTransferCommands(VkCommandBuffer commandBuffer,
+		std::vector<VkBufferMemoryBarrier> bufferBarriers, std::vector<VkImageMemoryBarrier> imageBarriers)
+{
+	VkCommandBuffer acquire = beginSingleTimeCommands();
+	recordOwnershipTransfer(commandBuffer, acquire, bufferBarriers, imageBarriers);
+	vkEndCommandBuffer(commandBuffer);
+	vkEndCommandBuffer(acquire);
+
+	VkSemaphore transferDone;
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	VkFence acquired;
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &transferDone) != VK_SUCCESS ||
+		vkCreateFence(device_, &fenceInfo, nullptr, &acquired) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create transfer sync objects!");
+	}
+
+	VkSubmitInfo transferSubmit{};
+	transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	transferSubmit.commandBufferCount = 1;
+	transferSubmit.pCommandBuffers = &commandBuffer;
+	transferSubmit.signalSemaphoreCount = 1;
+	transferSubmit.pSignalSemaphores = &transferDone;
+
+	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	VkSubmitInfo acquireSubmit{};
+	acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	acquireSubmit.waitSemaphoreCount = 1;
+	acquireSubmit.pWaitSemaphores = &transferDone;
+	acquireSubmit.pWaitDstStageMask = &waitStage;
+	acquireSubmit.commandBufferCount = 1;
+	acquireSubmit.pCommandBuffers = &acquire;
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex_);
+		vkQueueSubmit(transferQueue_, 1, &transferSubmit, VK_NULL_HANDLE);
+		vkQueueSubmit(graphicsQueue_, 1, &acquireSubmit, acquired);
+	}
+	vkWaitForFences(device_, 1, &acquired, VK_TRUE, UINT64_MAX); //the acquire waited on the transfer, both are done
+
+	vkDestroyFence(device_, acquired, nullptr);
+	vkDestroySemaphore(device_, transferDone, nullptr);
+	vkFreeCommandBuffers(device_, transferCommandPool, 1, &commandBuffer);
+	vkFreeCommandBuffers(device_, commandPool, 1, &acquire);
+}
+
 void EngineDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
 {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+	VkCommandBuffer commandBuffer = beginTransferCommands();
 
 	VkBufferCopy copyRegion{};
 	copyRegion.srcOffset = 0;	// Optional
@@ -526,13 +724,17 @@ void EngineDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSi
 	copyRegion.size = size;
 	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-	endSingleTimeCommands(commandBuffer);
+	VkBufferMemoryBarrier barrier{};
+	barrier.buffer = dstBuffer;
+	barrier.offset = 0;
+	barrier.size = size;
+	endTransferCommands(commandBuffer, {barrier}, {});
 }
 	
 void EngineDevice::copyBufferToImage(
 		VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount)
 {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+	VkCommandBuffer commandBuffer = beginTransferCommands();
 
 	VkBufferImageCopy region{};
 	region.bufferOffset = 0;
@@ -554,14 +756,25 @@ void EngineDevice::copyBufferToImage(
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			1,
 			&region);
-	endSingleTimeCommands(commandBuffer);
+
+	//the layout stays TRANSFER_DST_OPTIMAL, only the ownership moves
+	VkImageMemoryBarrier barrier{};
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = layerCount;
+	endTransferCommands(commandBuffer, {}, {barrier});
 }
 
 void EngineDevice::createImageWithInfo(
 		const VkImageCreateInfo &imageInfo,
 		VkMemoryPropertyFlags properties,
 		VkImage &image,
-		VkDeviceMemory &imageMemory)
+		DeviceAllocation &imageMemory)
 {
 	if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS)
 	{
@@ -571,17 +784,10 @@ void EngineDevice::createImageWithInfo(
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to allocate image memory!");
-	}
+	imageMemory = allocator_->allocate(memRequirements, findMemoryType(memRequirements.memoryTypeBits, properties),
+		imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
 
-	if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS)
+	if (vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to bind image memory!");
 	}
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "window.hpp"
+#include "device_memory.hpp"
 
 // std lib headers
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -20,9 +23,15 @@ struct QueueFamilyIndices
 {
 	uint32_t graphicsFamily;
 	uint32_t presentFamily;
+	//a transfer only family when the gpu has one (dma engine), else a second queue of the graphics family,
+	//else the graphics queue itself
+	uint32_t transferFamily;
+	uint32_t transferQueueIndex = 0;
+	bool graphicsFamilyHasCompute = false; //gpu culling dispatches on the graphics queue
 	bool graphicsFamilyHasValue = false;
 	bool presentFamilyHasValue = false;
 	bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
+	bool hasDedicatedTransferQueue() const { return transferFamily != graphicsFamily || transferQueueIndex != 0; }
 };
 
 class EngineDevice 
@@ -48,12 +57,17 @@ class EngineDevice
 	VkSurfaceKHR surface() { return surface_; }
 	VkQueue graphicsQueue() { return graphicsQueue_; }
 	VkQueue presentQueue() { return presentQueue_; }
+	VkQueue transferQueue() { return transferQueue_; }
+	VkCommandPool getTransferCommandPool() { return transferCommandPool; }
+	//queues are shared with the streaming thread, hold this around every vkQueue* call and vkDeviceWaitIdle
+	std::mutex &queueMutex() { return queueMutex_; }
+	void waitIdle();
 	VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
 	VkInstance getInstance() { return instance; }
 
 	SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
 	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-	QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
+	QueueFamilyIndices findPhysicalQueueFamilies() { return queueFamilies_; }
 	VkFormat findSupportedFormat(
 		const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
@@ -63,9 +77,18 @@ class EngineDevice
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkBuffer &buffer,
-		VkDeviceMemory &bufferMemory);
+		DeviceAllocation &bufferMemory);
 	VkCommandBuffer beginSingleTimeCommands();
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+	//same thing on the transfer queue, ending waits until the graphics family owns what was written
+	VkCommandBuffer beginTransferCommands();
+	void endTransferCommands(VkCommandBuffer commandBuffer,
+		std::vector<VkBufferMemoryBarrier> bufferBarriers, std::vector<VkImageMemoryBarrier> imageBarriers);
+	//hands what the transfer queue wrote over to the graphics family : release goes at the end of the transfer
+	//commands, acquire in a graphics command buffer that waits on a semaphore signaled by the transfer submit
+	//barriers only need the resource fields filled (buffer/offset/size, image/subresourceRange/layouts)
+	void recordOwnershipTransfer(VkCommandBuffer release, VkCommandBuffer acquire,
+		std::vector<VkBufferMemoryBarrier> &bufferBarriers, std::vector<VkImageMemoryBarrier> &imageBarriers);
 	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 	void copyBufferToImage(
 		VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
@@ -74,9 +97,15 @@ class EngineDevice
 		const VkImageCreateInfo &imageInfo,
 		VkMemoryPropertyFlags properties,
 		VkImage &image,
-		VkDeviceMemory &imageMemory);
+		DeviceAllocation &imageMemory);
+	//gives back memory from createBuffer or createImageWithInfo, destroy the buffer or image first
+	void freeMemory(DeviceAllocation &allocation) { allocator_->free(allocation); }
+	DeviceMemoryAllocator &memoryAllocator() { return *allocator_; }
 
 	VkPhysicalDeviceProperties properties;
+	VkPhysicalDeviceFeatures enabledFeatures{}; //what the logical device was created with, optional features depend on the gpu
+	//VK_KHR_draw_indirect_count when the device has it, null otherwise (the instance is 1.0, so not core)
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
 
 	private:
 	void createInstance();
@@ -94,6 +123,7 @@ class EngineDevice
 	void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
 	void hasGflwRequiredInstanceExtensions();
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+	bool checkDeviceExtensionSupport(VkPhysicalDevice device, const char *extension);
 	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
 	VkInstance instance;
@@ -101,11 +131,16 @@ class EngineDevice
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	Window &window;
 	VkCommandPool commandPool;
+	VkCommandPool transferCommandPool;
+	QueueFamilyIndices queueFamilies_;
 
 	VkDevice device_;
 	VkSurfaceKHR surface_;
 	VkQueue graphicsQueue_;
 	VkQueue presentQueue_;
+	VkQueue transferQueue_;
+	std::mutex queueMutex_;
+	std::unique_ptr<DeviceMemoryAllocator> allocator_; //every buffer and image lives in it
 
 	const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
 	const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -2,7 +2,7 @@
 
 #include "camera.hpp"
 #include "engine.hpp"
-#include "game_object.hpp"
+#include "scene.hpp"
 #include <vector>
 
 #define MAX_LIGHTS 10
@@ -28,6 +28,13 @@ namespace wind
 		int lightCount;
 	};
 
+	//per object entry of the object storage buffer (std430), draws pick theirs through gl_InstanceIndex
+	struct ObjectData
+	{
+		glm::mat4	modelMatrix{1.f}; //dequantize matrix already folded in
+		glm::mat4	normalMatrix{1.f};
+	};
+
 	typedef struct s_frame_info
 	{
 		int				frameIndex;
@@ -35,7 +42,8 @@ namespace wind
 		VkCommandBuffer	commandBuffer;
 		LveCamera		&camera;
 		VkDescriptorSet	globalDescriptorSet;
-		LveGameObject::Map &gameObjects;
+		Scene			&scene;
+		float			viewportHeight = 0.f; //swapchain height in pixels, used to turn lod errors into pixels
 	} t_frame_info;
 	
 }
\ No newline at end of file
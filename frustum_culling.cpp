@@ -0,0 +1,62 @@
+#include "frustum_culling.hpp"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define WIND_CULL_SSE 1
+#endif
+
+namespace wind
+{
+	size_t cullSpheres(const glm::vec4 planes[6], const SphereBatch &spheres, std::vector<uint8_t> &visible)
+	{
+		const size_t count = spheres.size();
+		visible.resize(count);
+		size_t visibleCount = 0;
+		size_t i = 0;
+
+#ifdef WIND_CULL_SSE
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; p++)
+		{
+			planeX[p] = _mm_set1_ps(planes[p].x);
+			planeY[p] = _mm_set1_ps(planes[p].y);
+			planeZ[p] = _mm_set1_ps(planes[p].z);
+			planeW[p] = _mm_set1_ps(planes[p].w);
+		}
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&spheres.x[i]);
+			__m128 y = _mm_loadu_ps(&spheres.y[i]);
+			__m128 z = _mm_loadu_ps(&spheres.z[i]);
+			__m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(&spheres.radius[i]));
+
+			//signed distance to each plane, a sphere is out as soon as it is fully behind one of them
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < 6; p++)
+			{
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+					_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+			}
+			int mask = _mm_movemask_ps(inside);
+			for (int k = 0; k < 4; k++)
+			{
+				visible[i + k] = static_cast<uint8_t>((mask >> k) & 1);
+				visibleCount += visible[i + k];
+			}
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++)
+				inside = planes[p].x * spheres.x[i] + planes[p].y * spheres.y[i] + planes[p].z * spheres.z[i] + planes[p].w >= -spheres.radius[i];
+			visible[i] = inside ? 1 : 0;
+			visibleCount += visible[i];
+		}
+		return visibleCount;
+	}
+}
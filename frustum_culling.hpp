@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wind
+{
+	//world space bounding spheres, one array per component so cullSpheres loads 4 of them at once
+	struct SphereBatch
+	{
+		std::vector<float>	x;
+		std::vector<float>	y;
+		std::vector<float>	z;
+		std::vector<float>	radius;
+
+		void clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+		void push(glm::vec3 center, float r) { x.push_back(center.x); y.push_back(center.y); z.push_back(center.z); radius.push_back(r); }
+		size_t size() const { return x.size(); }
+	};
+
+	//visible[i] is 1 when sphere i is at least partly on the inner side of all six planes (LveCamera::getFrustumPlanes)
+	//4 spheres per step with SSE, plain loop on other targets, returns how many are visible
+	size_t cullSpheres(const glm::vec4 planes[6], const SphereBatch &spheres, std::vector<uint8_t> &visible);
+}
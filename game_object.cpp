@@ -2,27 +2,64 @@
 
 namespace wind
 {
-	glm::mat4 TransformComponent::mat4() 
-	{ //fourth dimension is for homegeneous coordinate
-		auto transform = glm::translate(glm::mat4{1.f}, translation);
+	namespace
+	{
+		uint64_t composeCount = 0; //transforms are only composed on the main thread
+	}
 
-		transform = glm::rotate(transform, rotation.y, {0.f, 1.f, 0.f});
-		transform = glm::rotate(transform, rotation.x, {1.f, 0.f, 0.f});
-		transform = glm::rotate(transform, rotation.z, {0.f, 0.f, 1.f});
+	const glm::mat4 &TransformComponent::mat4()
+	{
+		if (isDirty())
+			compose();
+		return world;
+	}
 
-		transform = glm::scale(transform, glm::vec3(scale));
-		return transform;
+	const glm::mat4 &TransformComponent::normalMatrix()
+	{
+		if (isDirty())
+			compose();
+		return normal;
 	}
 
-	LveGameObject LveGameObject::create_point_light(float intensity, glm::vec3 color, float radius)
+	bool TransformComponent::isDirty() const
 	{
-		LveGameObject gameObj = LveGameObject::createGameObject();
+		return !composed || translation != composedTranslation || rotation != composedRotation || scale != composedScale;
+	}
+
+	void TransformComponent::compose()
+	{ //fourth dimension is for homegeneous coordinate
+		//translate * rotate Y * rotate X * rotate Z * scale written out, same as the glm::rotate chain without the matrix products
+		const float c3 = glm::cos(rotation.z);
+		const float s3 = glm::sin(rotation.z);
+		const float c2 = glm::cos(rotation.x);
+		const float s2 = glm::sin(rotation.x);
+		const float c1 = glm::cos(rotation.y);
+		const float s1 = glm::sin(rotation.y);
+		glm::mat4 rotationMatrix{
+			{c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1, 0.f},
+			{c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3, 0.f},
+			{c2 * s1, -s2, c1 * c2, 0.f},
+			{0.f, 0.f, 0.f, 1.f}};
 
-		gameObj.color = color;
-		gameObj.transform.scale = radius;
-		gameObj.point_light_intensity = intensity;
-		
-		return gameObj;
+		glm::mat4 transform = rotationMatrix;
+		for (int column = 0; column < 3; column++)
+			transform[column] *= scale;
+		transform[3] = glm::vec4(translation, 1.f);
+
+		const float inverseScale = scale != 0.f ? 1.f / scale : 0.f;
+		for (int column = 0; column < 3; column++)
+			rotationMatrix[column] *= inverseScale;
+		store(transform, rotationMatrix);
 	}
 
+	void TransformComponent::store(const glm::mat4 &world, const glm::mat4 &normal)
+	{
+		this->world = world;
+		this->normal = normal;
+		composedTranslation = translation;
+		composedRotation = rotation;
+		composedScale = scale;
+		composed = true;
+		version = ++composeCount;
+	}
 }
\ No newline at end of file
@@ -3,7 +3,6 @@
 #include "model.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
-#include <unordered_map>
 
 
 //physics constants
@@ -13,55 +12,92 @@ constexpr float GRAVITY = 9.81f;
 
 namespace wind
 {
+	class TransformBatch;
+
 	struct TransformComponent
 	{
 		glm::vec3 translation{};
-		float scale; 
+		float scale = 1.f;
 		glm::vec3 rotation{};
 		//object orientation in 3D is represented by angles on each of the 3D axis
 		//look for quaternions encoding later (probly state of art atm)
 		//here we will use tait-bryan Y X Z representation
-		glm::mat4 mat4();
-	};
-	
-	class LveGameObject
-	{
-		public:
-			using id_t = unsigned int;
-			using Map = std::unordered_map<id_t, LveGameObject>;
-			
-			static LveGameObject createGameObject()	
-			{
-				static id_t currentId = 0;
-				return LveGameObject{currentId++};
-			}
-
-			static LveGameObject create_point_light(float intensity = 10.f, glm::vec3 color = glm::vec3(1.f), float radius = 0.1f);
+		//both matrices are cached, they are only composed again when translation, rotation or scale changed
+		//(the fields are compared to the ones of the last composition, so writing them directly is fine)
+		const glm::mat4 &mat4();
+		//inverse transpose of mat4, the scale is uniform so it is the rotation divided by the scale
+		const glm::mat4 &normalMatrix();
+		bool isDirty() const;
+		//changes whenever the matrices are composed again, unique across transforms so a replaced component never matches
+		uint64_t getVersion() const { return version; }
 
-			LveGameObject(const LveGameObject&) = default;
-			LveGameObject& operator=(const LveGameObject&) = default;
-			LveGameObject(LveGameObject &&) = default;
-			LveGameObject& operator=(LveGameObject &&) = default;
+		private:
+			friend class TransformBatch; //composes dirty transforms in bulk and stores the result here
 
+			void compose();
+			void store(const glm::mat4 &world, const glm::mat4 &normal);
 
-			const id_t getId() { return (id) ; }
+			bool		composed = false;
+			glm::vec3	composedTranslation{};
+			float		composedScale = 0.f;
+			glm::vec3	composedRotation{};
+			glm::mat4	world{1.f};
+			glm::mat4	normal{1.f};
+			uint64_t	version = 0;
+	};
+	
+	//what an entity draws, entities without one (lights, the player) are skipped by the render systems
+	struct MeshComponent
+	{
+		std::shared_ptr<LveModel> model{}; //added once the streamed model is resident
+	};
 
+	//the light radius is the transform scale
+	struct PointLightComponent
+	{
+		glm::vec3	color{1.f};
+		float		intensity = 10.f;
+	};
 
-			std::shared_ptr<LveModel> model{};
-			glm::vec3 color{};
-			TransformComponent transform{};
+	//only bodies are moved by the physics, a mass of EARTH never moves and is what the others fall onto
+	//the fields are what the body starts with : on the first step after it was added PhysicsStepper takes them and
+	//the transform translation into its RigidBodyStore, which holds the simulated state from then on
+	//the transform gets a blend of the last two steps (PhysicsStepper::interpolate)
+	struct RigidBodyComponent
+	{
+		float		mass = 1.f;
+		glm::vec3	speed{0.f};
+		glm::vec3	acceleration{0.f};
+		uint32_t	body = UINT32_MAX; //index in the PhysicsStepper store, set when the body enters it
+	};
 
-			//optionnal value used if the object is a point light
-			float point_light_intensity = -1.0;
+	enum class ColliderShape : uint32_t
+	{
+		Sphere,
+		Box, //axis aligned in world space, rotation is ignored
+		Plane, //infinite, only on static bodies
+	};
 
-			//physical properties
-			float mass = -1.0;
-			glm::vec3 speed{0.f};
-			glm::vec3 acceleration{0.f};
+	//what a rigid body collides with, in world units around the body position (transform scale already applied)
+	struct ColliderComponent
+	{
+		ColliderShape	shape = ColliderShape::Sphere;
+		glm::vec3		center{0.f}; //offset from the body position, sphere and box
+		glm::vec3		halfExtents{0.5f}; //box
+		float			radius = 0.5f; //sphere
+		glm::vec3		normal{0.f, -1.f, 0.f}; //plane through the body position, towards the free side (y points down)
+		float			restitution = 0.3f; //bounce, the pair uses the larger one
+	};
 
-		private:
-			LveGameObject(id_t objId) : id{objId} {}
+	//the entity the keyboard moves and the camera follows
+	struct PlayerComponent
+	{
+		bool	local = true; //false for the ones the server tells us about
+	};
 
-			id_t	id;
+	//short lived entities (debris, projectiles), destroyed by the scene when it runs out
+	struct LifetimeComponent
+	{
+		float	remaining = 1.f; //seconds
 	};
 }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "geometry_pool.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace wind
+{
+	GeometryPool::GeometryPool(EngineDevice &device, VkDeviceSize vertexCapacity, VkDeviceSize indexCapacity)
+		: device{device}, vertexRanges{vertexCapacity}, indexRanges{indexCapacity}
+	{
+		createBuffers(vertexBuffer, indexBuffer);
+	}
+
+	GeometryPool::~GeometryPool()
+	{
+		if (!live.empty())
+			std::cerr << "geometry pool destroyed with " << live.size() << " models still in it" << std::endl;
+		destroy_buffer(vertexBuffer, device);
+		destroy_buffer(indexBuffer, device);
+	}
+
+	void GeometryPool::createBuffers(t_buffer &vertices, t_buffer &indices)
+	{
+		//transfer src so compact() can copy out of them
+		initialise_buffer(vertices,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			device, vertexRanges.getCapacity());
+		initialise_buffer(indices,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			device, indexRanges.getCapacity());
+	}
+
+	void GeometryPool::allocateVertices(Range &range, VkDeviceSize size, uint32_t stride)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!vertexRanges.allocate(size, stride, range.vertexOffset))
+			throw std::runtime_error("geometry pool is out of vertex space");
+		range.vertexSize = size;
+		range.vertexStride = stride;
+		live.insert(&range);
+	}
+
+	void GeometryPool::allocateIndices(Range &range, VkDeviceSize size, uint32_t stride)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!indexRanges.allocate(size, stride, range.indexOffset))
+			throw std::runtime_error("geometry pool is out of index space");
+		range.indexSize = size;
+		range.indexStride = stride;
+		live.insert(&range);
+	}
+
+	void GeometryPool::free(Range &range)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (range.vertexSize > 0)
+			vertexRanges.free(range.vertexOffset);
+		if (range.indexSize > 0)
+			indexRanges.free(range.indexOffset);
+		live.erase(&range);
+		range = Range{};
+	}
+
+	void GeometryPool::bindVertices(VkCommandBuffer commandBuffer)
+	{
+		VkBuffer buffers[] = {vertexBuffer.buffer};
+		VkDeviceSize offsets[] = {0};
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+	}
+
+	void GeometryPool::bindIndices(VkCommandBuffer commandBuffer, VkIndexType indexType)
+	{
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, indexType);
+	}
+
+	float GeometryPool::getFragmentation() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		float worst = 0.f;
+		for (const RangeAllocator *ranges : {&vertexRanges, &indexRanges})
+		{
+			uint64_t freeBytes = ranges->getCapacity() - ranges->getUsed();
+			if (freeBytes > 0)
+				worst = std::max(worst, 1.f - static_cast<float>(ranges->getLargestFree()) / static_cast<float>(freeBytes));
+		}
+		return worst;
+	}
+
+	bool GeometryPool::compact()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		RangeAllocator packedVertices{vertexRanges.getCapacity()};
+		RangeAllocator packedIndices{indexRanges.getCapacity()};
+		std::vector<VkBufferCopy> vertexCopies;
+		std::vector<VkBufferCopy> indexCopies;
+		std::vector<Range *> vertexMoved; //range of each copy
+		std::vector<Range *> indexMoved;
+
+		//repack in the current order, models loaded together stay together
+		//allocate pads every request for its alignment and rounds it up to a bin, so a nearly full pool may not
+		//fit packed, nothing is moved before every range found its place
+		std::vector<Range *> ranges(live.begin(), live.end());
+		std::sort(ranges.begin(), ranges.end(), [](const Range *a, const Range *b) { return a->vertexOffset < b->vertexOffset; });
+		for (Range *range : ranges)
+		{
+			if (range->vertexSize == 0)
+				continue;
+			VkBufferCopy copy{};
+			copy.srcOffset = range->vertexOffset;
+			copy.size = range->vertexSize;
+			if (!packedVertices.allocate(range->vertexSize, range->vertexStride, copy.dstOffset))
+			{
+				std::cerr << "Geometry pool compaction skipped : the vertex ranges don't fit packed" << std::endl;
+				return false;
+			}
+			vertexCopies.push_back(copy);
+			vertexMoved.push_back(range);
+		}
+		std::sort(ranges.begin(), ranges.end(), [](const Range *a, const Range *b) { return a->indexOffset < b->indexOffset; });
+		for (Range *range : ranges)
+		{
+			if (range->indexSize == 0)
+				continue;
+			VkBufferCopy copy{};
+			copy.srcOffset = range->indexOffset;
+			copy.size = range->indexSize;
+			if (!packedIndices.allocate(range->indexSize, range->indexStride, copy.dstOffset))
+			{
+				std::cerr << "Geometry pool compaction skipped : the index ranges don't fit packed" << std::endl;
+				return false;
+			}
+			indexCopies.push_back(copy);
+			indexMoved.push_back(range);
+		}
+		for (size_t i = 0; i < vertexCopies.size(); i++)
+			vertexMoved[i]->vertexOffset = vertexCopies[i].dstOffset;
+		for (size_t i = 0; i < indexCopies.size(); i++)
+			indexMoved[i]->indexOffset = indexCopies[i].dstOffset;
+
+		t_buffer vertices{}, indices{};
+		createBuffers(vertices, indices);
+
+		//graphics queue : it owns the old buffers, the new ones are first used there too
+		VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+		if (!vertexCopies.empty())
+			vkCmdCopyBuffer(commandBuffer, vertexBuffer.buffer, vertices.buffer, static_cast<uint32_t>(vertexCopies.size()), vertexCopies.data());
+		if (!indexCopies.empty())
+			vkCmdCopyBuffer(commandBuffer, indexBuffer.buffer, indices.buffer, static_cast<uint32_t>(indexCopies.size()), indexCopies.data());
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+		device.endSingleTimeCommands(commandBuffer); //idles the queue, no frame can still read the old buffers
+
+		destroy_buffer(vertexBuffer, device);
+		destroy_buffer(indexBuffer, device);
+		vertexBuffer = vertices;
+		indexBuffer = indices;
+		vertexRanges = std::move(packedVertices);
+		indexRanges = std::move(packedIndices);
+		compactions++;
+		std::cout << "Geometry pool compacted : " << vertexCopies.size() << " vertex ranges, " << indexCopies.size() << " index ranges moved" << std::endl;
+		return true;
+	}
+
+	void GeometryPool::printStats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::cout << "Geometry pool : " << live.size() << " models, vertices " << vertexRanges.getUsed() / 1024 << " / "
+			<< vertexRanges.getCapacity() / 1024 << " KB, indices " << indexRanges.getUsed() / 1024 << " / "
+			<< indexRanges.getCapacity() / 1024 << " KB" << std::endl;
+	}
+}
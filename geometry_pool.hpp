@@ -0,0 +1,78 @@
+#pragma once
+
+#include "engine.hpp"
+#include "initialise_buffers.hpp"
+#include "range_allocator.hpp"
+
+#include <mutex>
+#include <unordered_set>
+
+namespace wind
+{
+	//one device local vertex buffer and one index buffer shared by every model, so a frame binds geometry
+	//once instead of once per object, models draw through vertexOffset / firstIndex
+	//vertex ranges are aligned on their stride and index ranges on their index size, mixed formats can
+	//live in the same buffers and the offsets always come out as whole vertices / indices
+	//allocate and free are thread safe, the streaming thread allocates while the main thread frees
+	class GeometryPool
+	{
+		public:
+			static constexpr VkDeviceSize DEFAULT_VERTEX_CAPACITY = 64 * 1024 * 1024;
+			static constexpr VkDeviceSize DEFAULT_INDEX_CAPACITY = 32 * 1024 * 1024;
+
+			//offsets are in bytes, a model keeps one and hands its address to the pool
+			struct Range
+			{
+				VkDeviceSize	vertexOffset = 0;
+				VkDeviceSize	vertexSize = 0; //0 until allocateVertices
+				uint32_t		vertexStride = 0;
+				VkDeviceSize	indexOffset = 0;
+				VkDeviceSize	indexSize = 0; //0 until allocateIndices
+				uint32_t		indexStride = 0;
+
+				int32_t firstVertex() const { return vertexStride ? static_cast<int32_t>(vertexOffset / vertexStride) : 0; }
+				uint32_t firstIndex() const { return indexStride ? static_cast<uint32_t>(indexOffset / indexStride) : 0; }
+			};
+
+			GeometryPool(EngineDevice &device, VkDeviceSize vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+				VkDeviceSize indexCapacity = DEFAULT_INDEX_CAPACITY);
+			~GeometryPool();
+
+			GeometryPool(const GeometryPool &) = delete;
+			GeometryPool& operator=(const GeometryPool &) = delete;
+
+			//range must keep its address until free(), compact() moves it through that pointer
+			//throws when the pool has no room left
+			void allocateVertices(Range &range, VkDeviceSize size, uint32_t stride);
+			void allocateIndices(Range &range, VkDeviceSize size, uint32_t stride);
+			void free(Range &range); //the caller makes sure no frame in flight still draws it
+
+			VkBuffer getVertexBuffer() const { return vertexBuffer.buffer; }
+			VkBuffer getIndexBuffer() const { return indexBuffer.buffer; }
+			void bindVertices(VkCommandBuffer commandBuffer);
+			void bindIndices(VkCommandBuffer commandBuffer, VkIndexType indexType);
+
+			//share of free space that is not in the largest hole, 0 is packed
+			float getFragmentation() const;
+			//moves every live range to the front of freshly allocated buffers and drops the old ones
+			//idles the graphics queue, nothing may be uploading into the pool (no model streaming)
+			//false when the ranges don't fit packed (alignment padding in a nearly full pool), nothing moved then
+			bool compact();
+			//goes up on every compact(), anything that cached model offsets uploads them again when it changed
+			uint32_t getCompactionCount() const { return compactions; }
+			void printStats() const;
+
+		private:
+			EngineDevice	&device;
+			t_buffer		vertexBuffer{};
+			t_buffer		indexBuffer{};
+			RangeAllocator	vertexRanges;
+			RangeAllocator	indexRanges;
+
+			mutable std::mutex	mutex;
+			std::unordered_set<Range *> live;
+			uint32_t			compactions = 0;
+
+			void createBuffers(t_buffer &vertices, t_buffer &indices);
+	};
+}
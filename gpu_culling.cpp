@@ -0,0 +1,496 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "gpu_culling.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+namespace wind
+{
+	namespace
+	{
+		constexpr uint32_t MAX_MESHES = 4096; //distinct resident models
+		constexpr uint32_t SHADER_MAX_LODS = 8; //array size in cull.comp
+		constexpr uint32_t WORKGROUP_SIZE = 64; //local_size_x in cull.comp
+		constexpr uint32_t NONE = UINT32_MAX;
+		static_assert(LveModel::MAX_LOD_COUNT <= SHADER_MAX_LODS, "cull.comp mesh arrays are too small");
+
+		//std430 layouts of cull.comp, CullObject is in the header
+		struct CullMesh
+		{
+			uint32_t	lodFirstIndex[SHADER_MAX_LODS];
+			uint32_t	lodIndexCount[SHADER_MAX_LODS];
+			float		lodError[SHADER_MAX_LODS];
+			int32_t		vertexOffset;
+			uint32_t	lodCount;
+			uint32_t	bucket;
+			uint32_t	pad;
+		};
+
+		struct CullBucket
+		{
+			uint32_t	count;
+			uint32_t	base;
+		};
+
+		struct CullPushConstants
+		{
+			glm::vec4	frustumPlanes[6];
+			glm::vec4	camera;
+			uint32_t	objectCount;
+			uint32_t	compact;
+			uint32_t	pad[2];
+		};
+		static_assert(sizeof(CullPushConstants) <= 128, "push constants over the guaranteed limit");
+
+		uint32_t bucketOf(const LveModel &model)
+		{
+			return static_cast<uint32_t>(model.getVertexFormat()) * 2 + (model.getIndexType() == VK_INDEX_TYPE_UINT32 ? 1 : 0);
+		}
+	}
+
+	bool GpuCulling::isSupported(EngineDevice &device)
+	{
+		return device.enabledFeatures.multiDrawIndirect && device.enabledFeatures.drawIndirectFirstInstance
+			&& device.findPhysicalQueueFamilies().graphicsFamilyHasCompute;
+	}
+
+	GpuCulling::GpuCulling(EngineDevice &device, VkDescriptorSetLayout objectSetLayout) : device{device}
+	{
+		for (uint32_t b = 0; b < BUCKET_COUNT; b++)
+		{
+			buckets[b].format = static_cast<LveModel::VertexFormat>(b / 2);
+			buckets[b].indexType = (b & 1) ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+		}
+		createBuffers();
+		createDescriptors(objectSetLayout);
+		createPipeline();
+		std::cout << "gpu culling : " << (isCompacting() ? "draw indirect count" : "fixed count draws") << std::endl;
+	}
+
+	GpuCulling::~GpuCulling()
+	{
+		pipeline.reset();
+		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+		descriptorPool.destroy_pools(device);
+		vkDestroyDescriptorSetLayout(device.device(), descriptorSetLayout, nullptr);
+		destroy_buffer(objects, device);
+		destroy_buffer(objectData, device);
+		destroy_buffer(meshes, device);
+		for (FrameResources &frame : frames)
+		{
+			if (frame.stagingSize > 0)
+				destroy_buffer(frame.staging, device);
+			destroy_buffer(frame.buckets, device);
+			destroy_buffer(frame.draws, device);
+		}
+	}
+
+	void GpuCulling::createBuffers()
+	{
+		const VkBufferUsageFlags resident = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		initialise_buffer(objects, resident, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device, sizeof(CullObject) * MAX_OBJECTS);
+		initialise_buffer(objectData, resident, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device, sizeof(ObjectData) * MAX_OBJECTS);
+		initialise_buffer(meshes, resident, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device, sizeof(CullMesh) * MAX_MESHES);
+
+		const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		for (FrameResources &frame : frames)
+		{
+			initialise_buffer(frame.buckets, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, hostVisible,
+				device, sizeof(CullBucket) * BUCKET_COUNT);
+			//transfer dst : the fixed count path clears it before the dispatch
+			initialise_buffer(frame.draws, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device, sizeof(VkDrawIndexedIndirectCommand) * MAX_OBJECTS);
+			std::memset(frame.buckets.data, 0, sizeof(CullBucket) * BUCKET_COUNT);
+		}
+	}
+
+	void GpuCulling::createDescriptors(VkDescriptorSetLayout objectSetLayout)
+	{
+		VkDescriptorSetLayoutBinding bindings[4]{};
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 4;
+		layoutInfo.pBindings = bindings;
+		if (vkCreateDescriptorSetLayout(device.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+			throw std::runtime_error("failed to create descriptor set layout");
+
+		//one compute set per frame in flight and the object set of the draws
+		std::vector<DescriptorPool::PoolSizeRatio> poolRatios = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4}};
+		descriptorPool.init(device, LveSwapChain::MAX_FRAMES_IN_FLIGHT + 1, poolRatios);
+		for (FrameResources &frame : frames)
+		{
+			DescriptorWriter writer{};
+			VkDescriptorBufferInfo bufferInfos[4]{}; //the writes point at them until update_set
+			writer.write_buffer(0, objects.buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfos[0]);
+			writer.write_buffer(1, meshes.buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfos[1]);
+			writer.write_buffer(2, frame.draws.buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfos[2]);
+			writer.write_buffer(3, frame.buckets.buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfos[3]);
+			descriptorPool.allocate(device, descriptorSetLayout, frame.descriptorSet, nullptr);
+			writer.update_set(device, frame.descriptorSet);
+		}
+
+		DescriptorWriter writer{};
+		VkDescriptorBufferInfo bufferInfo{};
+		writer.write_buffer(0, objectData.buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfo);
+		descriptorPool.allocate(device, objectSetLayout, objectDescriptorSet, nullptr);
+		writer.update_set(device, objectDescriptorSet);
+	}
+
+	void GpuCulling::createPipeline()
+	{
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(CullPushConstants);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+			throw std::runtime_error("failed to create pipeline layout");
+		pipeline = std::make_unique<ComputePipeline>(device, "shaders/cull.comp.spv", pipelineLayout);
+	}
+
+	uint32_t GpuCulling::acquireMesh(const std::shared_ptr<LveModel> &model)
+	{
+		auto found = meshIndices.find(model.get());
+		if (found != meshIndices.end())
+		{
+			residentMeshes[found->second].users++;
+			return found->second;
+		}
+		uint32_t mesh;
+		if (!freeMeshes.empty())
+		{
+			mesh = freeMeshes.back();
+			freeMeshes.pop_back();
+		}
+		else if (residentMeshes.size() < MAX_MESHES)
+		{
+			mesh = static_cast<uint32_t>(residentMeshes.size());
+			residentMeshes.emplace_back();
+		}
+		else
+			return NONE;
+		residentMeshes[mesh].model = model;
+		residentMeshes[mesh].users = 1;
+		meshIndices.emplace(model.get(), mesh);
+		dirtyMeshes.push_back(mesh);
+		return mesh;
+	}
+
+	void GpuCulling::releaseMesh(uint32_t mesh)
+	{
+		ResidentMesh &resident = residentMeshes[mesh];
+		if (--resident.users > 0)
+			return;
+		meshIndices.erase(resident.model.get());
+		resident.model.reset();
+		freeMeshes.push_back(mesh);
+	}
+
+	//swap-pop, the last record moves into the hole and is written again there
+	void GpuCulling::removeResident(uint32_t index)
+	{
+		Resident &removed = residents[index];
+		buckets[bucketOf(*removed.model)].objectCount--;
+		releaseMesh(removed.mesh);
+		if (residentOf[entityIndex(removed.entity)] == index)
+			residentOf[entityIndex(removed.entity)] = NONE;
+
+		const uint32_t last = static_cast<uint32_t>(residents.size() - 1);
+		if (index != last)
+		{
+			residents[index] = residents[last];
+			uint32_t &slot = residentOf[entityIndex(residents[index].entity)];
+			if (slot == last)
+				slot = index;
+			residents[index].dirty = true;
+			dirtyObjects.push_back(index);
+		}
+		residents.pop_back();
+	}
+
+	void GpuCulling::clear()
+	{
+		residents.clear();
+		residentOf.clear();
+		residentMeshes.clear();
+		freeMeshes.clear();
+		meshIndices.clear();
+		dirtyObjects.clear();
+		dirtyMeshes.clear();
+		for (Bucket &bucket : buckets)
+			bucket.objectCount = 0;
+		geometry = nullptr;
+	}
+
+	void GpuCulling::cull(const s_frame_info &frameInfo, float lodErrorThreshold, std::vector<Entity> &leftovers)
+	{
+		FrameResources &frame = frames[frameInfo.frameIndex];
+		auto *gpuBuckets = static_cast<CullBucket *>(frame.buckets.data);
+
+		//the fence of this frame index has been waited on, the counts of its last use are final
+		visibleCount = 0;
+		for (uint32_t b = 0; b < BUCKET_COUNT; b++)
+			visibleCount += gpuBuckets[b].count;
+
+		//compacting the pool moved the model ranges, every mesh record is stale
+		if (geometry != nullptr && geometry->getCompactionCount() != geometryCompactions)
+		{
+			geometryCompactions = geometry->getCompactionCount();
+			for (uint32_t mesh = 0; mesh < residentMeshes.size(); mesh++)
+				if (residentMeshes[mesh].model != nullptr)
+					dirtyMeshes.push_back(mesh);
+		}
+
+		cullCount++;
+		Scene &scene = frameInfo.scene;
+		auto &sceneMeshes = scene.meshes;
+		for (size_t i = 0; i < sceneMeshes.size(); i++)
+		{
+			const std::shared_ptr<LveModel> &model = sceneMeshes[i].model;
+			if (model == nullptr)
+				continue;
+			const Entity entity = sceneMeshes.entity(i);
+			const uint32_t slot = entityIndex(entity);
+			TransformComponent &transform = *scene.transforms.get(entity);
+			transform.mat4(); //composes it if it moved since the transform batch, which changes its version
+
+			uint32_t index = slot < residentOf.size() ? residentOf[slot] : NONE;
+			if (index != NONE && residents[index].entity == entity)
+			{
+				Resident &resident = residents[index];
+				if (resident.model == model.get())
+				{
+					resident.seen = cullCount;
+					if (!resident.dirty && resident.transformVersion != transform.getVersion())
+					{
+						resident.dirty = true;
+						dirtyObjects.push_back(index);
+					}
+					continue;
+				}
+				removeResident(index); //another model now, goes in again as a new object
+			}
+
+			if (!model->hasIndices() || residents.size() >= MAX_OBJECTS || (geometry != nullptr && &model->getGeometryPool() != geometry))
+			{
+				leftovers.push_back(entity);
+				continue;
+			}
+			const uint32_t mesh = acquireMesh(model);
+			if (mesh == NONE)
+			{
+				leftovers.push_back(entity);
+				continue;
+			}
+			if (geometry == nullptr)
+			{
+				geometry = &model->getGeometryPool();
+				geometryCompactions = geometry->getCompactionCount();
+			}
+
+			index = static_cast<uint32_t>(residents.size());
+			residents.push_back({entity, model.get(), mesh, 0, cullCount, true});
+			dirtyObjects.push_back(index);
+			if (slot >= residentOf.size())
+				residentOf.resize(slot + 1, NONE);
+			residentOf[slot] = index;
+			buckets[bucketOf(*model)].objectCount++;
+		}
+
+		//the ones not seen lost their mesh or their entity, from the back so the records moving down were all seen
+		for (size_t i = residents.size(); i-- > 0;)
+			if (residents[i].seen != cullCount)
+				removeResident(static_cast<uint32_t>(i));
+		if (residents.empty())
+			geometry = nullptr;
+
+		uint32_t first = 0;
+		for (uint32_t b = 0; b < BUCKET_COUNT; b++)
+		{
+			buckets[b].first = first;
+			gpuBuckets[b] = {0, first};
+			first += buckets[b].objectCount;
+		}
+
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+		upload(frameInfo);
+		if (residents.empty())
+			return;
+
+		if (!isCompacting()) //the slots no visible object fills must draw nothing
+		{
+			vkCmdFillBuffer(commandBuffer, frame.draws.buffer, 0, residents.size() * sizeof(VkDrawIndexedIndirectCommand), 0);
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+				1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		CullPushConstants push{};
+		frameInfo.camera.getFrustumPlanes(push.frustumPlanes);
+		//w <= 0 keeps lod 0, like selectLod without a viewport
+		push.camera = glm::vec4(frameInfo.camera.getPosition(),
+			frameInfo.viewportHeight > 0.f ? frameInfo.camera.projectedSize(1.f, 1.f, frameInfo.viewportHeight) / lodErrorThreshold : 0.f);
+		push.objectCount = static_cast<uint32_t>(residents.size());
+		push.compact = isCompacting() ? 1 : 0;
+
+		pipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &push);
+		vkCmdDispatch(commandBuffer, (push.objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+		//commands and counts are read by the indirect draws of the render pass that follows
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	//writes the dirty records to this frame staging buffer and scatters them into the resident buffers,
+	//one copy command per destination buffer
+	void GpuCulling::upload(const s_frame_info &frameInfo)
+	{
+		uploadCount = 0;
+		const VkDeviceSize size = dirtyObjects.size() * (sizeof(CullObject) + sizeof(ObjectData)) + dirtyMeshes.size() * sizeof(CullMesh);
+		if (size == 0)
+			return;
+
+		FrameResources &frame = frames[frameInfo.frameIndex];
+		if (frame.stagingSize < size) //its last use is finished, same fence as the buckets
+		{
+			if (frame.stagingSize > 0)
+				destroy_buffer(frame.staging, device);
+			frame.stagingSize = std::max(size, frame.stagingSize * 2);
+			initialise_buffer(frame.staging, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device, frame.stagingSize);
+		}
+
+		char *staging = static_cast<char *>(frame.staging.data);
+		VkDeviceSize offset = 0;
+		objectCopies.clear();
+		dataCopies.clear();
+		meshCopies.clear();
+		for (uint32_t index : dirtyObjects)
+		{
+			//removals may have moved or dropped it since it was marked, the dirty flag follows the record
+			if (index >= residents.size() || !residents[index].dirty)
+				continue;
+			Resident &resident = residents[index];
+			resident.dirty = false;
+			const LveModel &model = *resident.model;
+			TransformComponent &transform = *frameInfo.scene.transforms.get(resident.entity);
+			const glm::mat4 &modelMatrix = transform.mat4();
+			resident.transformVersion = transform.getVersion();
+
+			ObjectData data{};
+			data.modelMatrix = modelMatrix * model.getDequantizeMatrix();
+			data.normalMatrix = transform.normalMatrix();
+			std::memcpy(staging + offset, &data, sizeof(ObjectData));
+			dataCopies.push_back({offset, index * sizeof(ObjectData), sizeof(ObjectData)});
+			offset += sizeof(ObjectData);
+
+			const float scale = glm::abs(transform.scale);
+			CullObject object{};
+			object.sphere = glm::vec4(glm::vec3(modelMatrix * glm::vec4(model.getBoundsCenter(), 1.f)), model.getBoundsRadius() * scale);
+			object.scale = scale;
+			object.mesh = resident.mesh;
+			std::memcpy(staging + offset, &object, sizeof(CullObject));
+			objectCopies.push_back({offset, index * sizeof(CullObject), sizeof(CullObject)});
+			offset += sizeof(CullObject);
+			uploadCount++;
+		}
+		for (uint32_t mesh : dirtyMeshes)
+		{
+			if (residentMeshes[mesh].model == nullptr) //released again since
+				continue;
+			const LveModel &model = *residentMeshes[mesh].model;
+			CullMesh gpuMesh{};
+			gpuMesh.lodCount = model.getLodCount();
+			for (uint32_t lod = 0; lod < model.getLodCount(); lod++)
+			{
+				gpuMesh.lodFirstIndex[lod] = model.getFirstIndex() + model.getLod(lod).firstIndex;
+				gpuMesh.lodIndexCount[lod] = model.getLod(lod).indexCount;
+				gpuMesh.lodError[lod] = model.getLod(lod).error;
+			}
+			gpuMesh.vertexOffset = model.getVertexOffset();
+			gpuMesh.bucket = bucketOf(model);
+			std::memcpy(staging + offset, &gpuMesh, sizeof(CullMesh));
+			meshCopies.push_back({offset, mesh * sizeof(CullMesh), sizeof(CullMesh)});
+			offset += sizeof(CullMesh);
+		}
+		dirtyObjects.clear();
+		dirtyMeshes.clear();
+		if (offset == 0)
+			return;
+
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+		//earlier frames may still be reading the records about to be overwritten
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+		if (!objectCopies.empty())
+			vkCmdCopyBuffer(commandBuffer, frame.staging.buffer, objects.buffer, static_cast<uint32_t>(objectCopies.size()), objectCopies.data());
+		if (!dataCopies.empty())
+			vkCmdCopyBuffer(commandBuffer, frame.staging.buffer, objectData.buffer, static_cast<uint32_t>(dataCopies.size()), dataCopies.data());
+		if (!meshCopies.empty())
+			vkCmdCopyBuffer(commandBuffer, frame.staging.buffer, meshes.buffer, static_cast<uint32_t>(meshCopies.size()), meshCopies.data());
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void GpuCulling::draw(const s_frame_info &frameInfo, const std::array<std::unique_ptr<Pipeline>, LveModel::VERTEX_FORMAT_COUNT> &pipelines,
+		VkPipelineLayout pipelineLayout, RenderState &state)
+	{
+		drawCalls = 0;
+		if (residents.empty())
+			return;
+		FrameResources &frame = frames[frameInfo.frameIndex];
+		VkCommandBuffer commandBuffer = state.getCommandBuffer();
+		const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+		state.bindDescriptorSet(pipelineLayout, 1, objectDescriptorSet);
+		state.bindVertexBuffer(0, geometry->getVertexBuffer());
+
+		for (uint32_t b = 0; b < BUCKET_COUNT; b++)
+		{
+			const Bucket &bucket = buckets[b];
+			if (bucket.objectCount == 0)
+				continue;
+			state.bindPipeline(*pipelines[static_cast<int>(bucket.format)]);
+			state.bindIndexBuffer(geometry->getIndexBuffer(), bucket.indexType);
+			if (isCompacting())
+			{
+				device.cmdDrawIndexedIndirectCount(commandBuffer, frame.draws.buffer, bucket.first * stride,
+					frame.buckets.buffer, b * sizeof(CullBucket), bucket.objectCount, stride);
+			}
+			else
+				vkCmdDrawIndexedIndirect(commandBuffer, frame.draws.buffer, bucket.first * stride, bucket.objectCount, stride);
+			drawCalls++;
+		}
+	}
+}
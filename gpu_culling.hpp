@@ -0,0 +1,142 @@
+#pragma once
+
+#include "engine.hpp"
+#include "descriptors.hpp"
+#include "frame_info.hpp"
+#include "geometry_pool.hpp"
+#include "initialise_buffers.hpp"
+#include "model.hpp"
+#include "pipeline.hpp"
+#include "render_queue.hpp"
+#include "swap_chain.hpp"
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace wind
+{
+	//gpu driven path of SimpleRenderSystem : every object has a record resident on the gpu (transform, bounds, mesh),
+	//a compute shader culls it, picks its lod and writes its indirect draw command
+	//the cpu only compares each mesh entity with its record and uploads the ones that moved, were added or went away
+	//commands are grouped in buckets of vertex format and index type, one indirect draw per bucket
+	//with VK_KHR_draw_indirect_count the visible commands are drawn with the gpu count,
+	//without it every bucket draws all of its slots and the ones no visible object filled are cleared to no instance
+	class GpuCulling
+	{
+		public:
+			static constexpr uint32_t MAX_OBJECTS = 131072; //resident, past that objects go back to the cpu path
+			static constexpr uint32_t BUCKET_COUNT = LveModel::VERTEX_FORMAT_COUNT * 2; //vertex format * 16 / 32 bit indices
+
+			struct Bucket
+			{
+				uint32_t				first = 0; //first command in the draw buffer
+				uint32_t				objectCount = 0; //upper bound of the draws, the gpu count is lower when compacting
+				LveModel::VertexFormat	format = LveModel::VertexFormat::Full;
+				VkIndexType				indexType = VK_INDEX_TYPE_UINT32;
+			};
+
+			//needs multiDrawIndirect, drawIndirectFirstInstance and compute on the graphics queue
+			static bool isSupported(EngineDevice &device);
+
+			//objectSetLayout is set 1 of the draw pipelines, a single ObjectData storage buffer
+			GpuCulling(EngineDevice &device, VkDescriptorSetLayout objectSetLayout);
+			~GpuCulling();
+
+			GpuCulling(const GpuCulling &) = delete;
+			GpuCulling& operator=(const GpuCulling &) = delete;
+
+			//uploads the records that changed and records the culling dispatch, outside of any render pass
+			//objects it can't take (no index buffer, another geometry pool, over MAX_OBJECTS) end up in leftovers
+			void cull(const s_frame_info &frameInfo, float lodErrorThreshold, std::vector<Entity> &leftovers);
+			//records the indirect draws, inside the render pass, pipelines are indexed by vertex format
+			//the transforms are in getObjectDescriptorSet, bound here as set 1 of pipelineLayout
+			void draw(const s_frame_info &frameInfo, const std::array<std::unique_ptr<Pipeline>, LveModel::VERTEX_FORMAT_COUNT> &pipelines,
+				VkPipelineLayout pipelineLayout, RenderState &state);
+			//drops every record, the models they kept alive are released (gpu culling turned off)
+			void clear();
+
+			bool isCompacting() const { return device.cmdDrawIndexedIndirectCount != nullptr; }
+			uint32_t getObjectCount() const { return static_cast<uint32_t>(residents.size()); } //objects culled by the gpu
+			uint32_t getUploadCount() const { return uploadCount; } //records written by the last cull
+			//visible objects counted by the gpu, read back MAX_FRAMES_IN_FLIGHT frames late
+			uint32_t getVisibleCount() const { return visibleCount; }
+			uint32_t getDrawCalls() const { return drawCalls; }
+
+		private:
+			//std430 object record of cull.comp
+			struct CullObject
+			{
+				glm::vec4	sphere; //world center, world radius
+				float		scale;
+				uint32_t	mesh;
+				uint32_t	pad[2];
+			};
+
+			//what the record at the same index was built from
+			struct Resident
+			{
+				Entity		entity;
+				LveModel	*model;
+				uint32_t	mesh;
+				uint64_t	transformVersion;
+				uint32_t	seen; //cull count when its entity was last found
+				bool		dirty;
+			};
+
+			struct ResidentMesh
+			{
+				std::shared_ptr<LveModel>	model; //kept alive while a record draws it
+				uint32_t					users = 0;
+			};
+
+			struct FrameResources
+			{
+				t_buffer		staging{}; //records written this frame, host visible, grows when a frame writes more
+				VkDeviceSize	stagingSize = 0;
+				t_buffer		buckets{}; //count and base per bucket, host visible so the counts can be read back
+				t_buffer		draws{}; //written by the compute shader only
+				VkDescriptorSet	descriptorSet = VK_NULL_HANDLE;
+			};
+
+			EngineDevice	&device;
+			t_buffer		objects{}; //CullObject per resident, device local
+			t_buffer		objectData{}; //ObjectData per resident, read by the vertex shader through gl_InstanceIndex
+			t_buffer		meshes{}; //CullMesh per resident mesh, device local
+			std::array<FrameResources, LveSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+			DescriptorPool	descriptorPool{};
+			VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+			VkDescriptorSet	objectDescriptorSet = VK_NULL_HANDLE;
+			VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+			std::unique_ptr<ComputePipeline> pipeline;
+
+			std::array<Bucket, BUCKET_COUNT> buckets{};
+			GeometryPool	*geometry = nullptr; //the pool every resident model lives in
+			uint32_t		geometryCompactions = 0; //of that pool when the meshes were written
+			uint32_t		cullCount = 0;
+			uint32_t		uploadCount = 0;
+			uint32_t		visibleCount = 0;
+			uint32_t		drawCalls = 0;
+
+			std::vector<Resident>	residents; //index is the record index and the firstInstance of its command
+			std::vector<uint32_t>	residentOf; //entity slot -> residents index
+			std::vector<ResidentMesh> residentMeshes; //index is the mesh record index
+			std::vector<uint32_t>	freeMeshes;
+			std::unordered_map<const LveModel *, uint32_t> meshIndices;
+			//per frame scratch, kept to reuse the allocations
+			std::vector<uint32_t>	dirtyObjects;
+			std::vector<uint32_t>	dirtyMeshes;
+			std::vector<VkBufferCopy> objectCopies;
+			std::vector<VkBufferCopy> dataCopies;
+			std::vector<VkBufferCopy> meshCopies;
+
+			void createBuffers();
+			void createDescriptors(VkDescriptorSetLayout objectSetLayout);
+			void createPipeline();
+			uint32_t acquireMesh(const std::shared_ptr<LveModel> &model); //NONE when the mesh buffer is full
+			void releaseMesh(uint32_t mesh);
+			void removeResident(uint32_t index);
+			void upload(const s_frame_info &frameInfo);
+	};
+}
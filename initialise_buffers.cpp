@@ -15,12 +15,15 @@ namespace wind
 			buffer.buffer,
 			buffer.memory
 		);
+		buffer.data = buffer.memory.mapped;
 		//std::cout << "does buffer == buffer : " << buffer.buffer << std::endl;
  	}
 
 	void destroy_buffer(t_buffer &buffer, EngineDevice &device)
 	{
 		vkDestroyBuffer(device.device(), buffer.buffer, nullptr);
-		vkFreeMemory(device.device(), buffer.memory, nullptr);
+		device.freeMemory(buffer.memory);
+		buffer.buffer = VK_NULL_HANDLE;
+		buffer.data = nullptr;
 	}
 }
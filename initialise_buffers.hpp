@@ -9,8 +9,8 @@ namespace wind
 	typedef struct s_buffer
 	{
 		VkBuffer buffer = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
-		void* data = nullptr;
+		DeviceAllocation memory{}; //a slice of a shared block, see DeviceMemoryAllocator
+		void* data = nullptr; //persistently mapped for host visible memory, null otherwise
 	} t_buffer;
 
 	void initialise_buffer(t_buffer &buffer, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryFlags, EngineDevice &device, VkDeviceSize bufferSize);
@@ -22,7 +22,7 @@ namespace wind
 				int lookDown = GLFW_KEY_DOWN;
 			};
 
-			void moveInPlaneXZ(GLFWwindow* window, float dt, LveGameObject& gameObject); //this system is dependent on glfw 
+			void moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform); //this system is dependent on glfw 
 
 			KeyMappings keys{};
 			float moveSpeed {3.f};
@@ -0,0 +1,56 @@
+#include "mapped_file.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace wind
+{
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	bool MappedFile::open(const std::string &filepath)
+	{
+		close();
+
+		int fd = ::open(filepath.c_str(), O_RDONLY);
+		if (fd == -1)
+			return false;
+
+		struct stat info;
+		if (fstat(fd, &info) == -1)
+		{
+			::close(fd);
+			return false;
+		}
+
+		length = static_cast<size_t>(info.st_size);
+		if (length > 0) //mmap refuses empty mappings, an empty file is still a valid open
+		{
+			mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping == MAP_FAILED)
+			{
+				mapping = nullptr;
+				length = 0;
+				::close(fd);
+				return false;
+			}
+			madvise(mapping, length, MADV_SEQUENTIAL);
+		}
+		::close(fd); //the mapping keeps its own reference to the file
+		opened = true;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (mapping != nullptr)
+			munmap(mapping, length);
+		mapping = nullptr;
+		length = 0;
+		opened = false;
+	}
+}
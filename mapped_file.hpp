@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace wind
+{
+	//read only memory mapping of a whole file, the kernel pages it in for us so no copy through a stream
+	class MappedFile
+	{
+		public:
+			MappedFile() = default;
+			~MappedFile();
+
+			MappedFile(const MappedFile &) = delete;
+			MappedFile& operator=(const MappedFile &) = delete;
+
+			bool open(const std::string &filepath); //returns false if the file can't be opened or mapped
+			void close();
+
+			const char *data() const { return static_cast<const char *>(mapping); }
+			size_t size() const { return length; }
+			bool isOpen() const { return opened; }
+
+		private:
+			void	*mapping = nullptr;
+			size_t	length = 0;
+			bool	opened = false;
+	};
+}
@@ -0,0 +1,132 @@
+#include "mesh_cache.hpp"
+#include "mapped_file.hpp"
+
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+
+namespace wind
+{
+	std::string meshCachePath(const std::string &sourcePath)
+	{
+		size_t dot = sourcePath.find_last_of('.');
+		size_t slash = sourcePath.find_last_of('/');
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			return sourcePath + ".wmesh";
+		return sourcePath.substr(0, dot) + ".wmesh";
+	}
+
+	bool readMeshCache(const std::string &cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t flags, LveModel::Builder &builder)
+	{
+		MappedFile file;
+		if (!file.open(cachePath) || file.size() < sizeof(MeshCacheHeader))
+			return false;
+
+		MeshCacheHeader header;
+		std::memcpy(&header, file.data(), sizeof(header));
+
+		if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != MESH_CACHE_VERSION
+			|| header.vertexStride != sizeof(LveModel::Vertex)
+			|| header.sourceHash != sourceHash
+			|| header.sourceSize != sourceSize
+			|| header.flags != flags)
+			return false;
+
+		size_t vertexBytes = static_cast<size_t>(header.vertexCount) * sizeof(LveModel::Vertex);
+		size_t indexBytes = static_cast<size_t>(header.indexCount) * sizeof(uint32_t);
+		size_t lodBytes = static_cast<size_t>(header.lodCount) * sizeof(LveModel::LodLevel);
+		size_t meshletBytes = static_cast<size_t>(header.meshletCount) * sizeof(LveModel::Meshlet);
+		if (file.size() != sizeof(MeshCacheHeader) + vertexBytes + indexBytes + lodBytes + meshletBytes) //truncated write or garbage
+			return false;
+		//the lod levels go into fixed size arrays and every range is drawn as is, nothing past the index buffer
+		if (header.lodCount == 0 || header.lodCount > LveModel::MAX_LOD_COUNT)
+			return false;
+
+		//one bulk copy per array straight out of the page cache, no per vertex work
+		const char *payload = file.data() + sizeof(MeshCacheHeader);
+		auto inIndices = [&header](uint32_t firstIndex, uint32_t indexCount)
+		{
+			return static_cast<uint64_t>(firstIndex) + indexCount <= header.indexCount;
+		};
+		for (uint32_t i = 0; i < header.lodCount; i++)
+		{
+			LveModel::LodLevel lod;
+			std::memcpy(&lod, payload + vertexBytes + indexBytes + i * sizeof(lod), sizeof(lod));
+			if (!inIndices(lod.firstIndex, lod.indexCount))
+				return false;
+		}
+		for (uint32_t i = 0; i < header.meshletCount; i++)
+		{
+			LveModel::Meshlet meshlet;
+			std::memcpy(&meshlet, payload + vertexBytes + indexBytes + lodBytes + i * sizeof(meshlet), sizeof(meshlet));
+			if (!inIndices(meshlet.firstIndex, meshlet.indexCount))
+				return false;
+		}
+		builder.vertices.resize(header.vertexCount);
+		std::memcpy(builder.vertices.data(), payload, vertexBytes);
+		builder.indices.resize(header.indexCount);
+		std::memcpy(builder.indices.data(), payload + vertexBytes, indexBytes);
+		builder.lods.resize(header.lodCount);
+		std::memcpy(builder.lods.data(), payload + vertexBytes + indexBytes, lodBytes);
+		builder.meshlets.resize(header.meshletCount);
+		std::memcpy(builder.meshlets.data(), payload + vertexBytes + indexBytes + lodBytes, meshletBytes);
+
+		builder.boundsMin = {header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]};
+		builder.boundsMax = {header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]};
+		return true;
+	}
+
+	bool writeMeshCache(const std::string &cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t flags, const LveModel::Builder &builder)
+	{
+		MeshCacheHeader header{};
+		std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+		header.version = MESH_CACHE_VERSION;
+		header.sourceHash = sourceHash;
+		header.sourceSize = sourceSize;
+		header.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+		header.indexCount = static_cast<uint32_t>(builder.indices.size());
+		header.vertexStride = sizeof(LveModel::Vertex);
+		header.flags = flags;
+		//a builder without levels is one level over the whole index buffer, written out so the reader can insist on one
+		const LveModel::LodLevel wholeMesh{0, static_cast<uint32_t>(builder.indices.size()), 0.f};
+		const LveModel::LodLevel *lods = builder.lods.empty() ? &wholeMesh : builder.lods.data();
+		header.lodCount = builder.lods.empty() ? 1 : static_cast<uint32_t>(builder.lods.size());
+		header.meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+		for (int i = 0; i < 3; i++)
+		{
+			header.boundsMin[i] = builder.boundsMin[i];
+			header.boundsMax[i] = builder.boundsMax[i];
+		}
+
+		//write next to the final file then rename so a crash never leaves a half written cache behind
+		std::string tmpPath = cachePath + ".tmp";
+		{
+			std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				std::cerr << "could not write mesh cache " << cachePath << std::endl;
+				return false;
+			}
+			file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char *>(builder.vertices.data()), builder.vertices.size() * sizeof(LveModel::Vertex));
+			file.write(reinterpret_cast<const char *>(builder.indices.data()), builder.indices.size() * sizeof(uint32_t));
+			file.write(reinterpret_cast<const char *>(lods), header.lodCount * sizeof(LveModel::LodLevel));
+			file.write(reinterpret_cast<const char *>(builder.meshlets.data()), builder.meshlets.size() * sizeof(LveModel::Meshlet));
+			if (!file)
+			{
+				file.close();
+				std::remove(tmpPath.c_str());
+				std::cerr << "could not write mesh cache " << cachePath << std::endl;
+				return false;
+			}
+		}
+		if (std::rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+		{
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <string>
+#include <cstdint>
+
+namespace wind
+{
+	//.wmesh layout : header, then vertexCount Vertex structs, then indexCount uint32_t, then lodCount LodLevel, then meshletCount Meshlet, all tightly packed
+	struct MeshCacheHeader
+	{
+		char		magic[4];
+		uint32_t	version;
+		uint64_t	sourceHash; //hash of the whole obj file, a changed obj means a stale cache
+		uint64_t	sourceSize;
+		uint32_t	vertexCount;
+		uint32_t	indexCount;
+		uint32_t	vertexStride; //sizeof(Vertex) when written, guards against Vertex layout changes
+		uint32_t	flags; //import options the cache was built with
+		uint32_t	lodCount;
+		uint32_t	meshletCount;
+		float		boundsMin[3];
+		float		boundsMax[3];
+	};
+
+	constexpr char MESH_CACHE_MAGIC[4] = {'W', 'M', 'S', 'H'};
+	constexpr uint32_t MESH_CACHE_VERSION = 5; //bump this whenever the layout or the importer output changes
+
+	//import options, part of the cache key
+	constexpr uint32_t MESH_CACHE_FLAG_OPTIMIZED = 1 << 0;
+	constexpr uint32_t MESH_CACHE_FLAG_LODS = 1 << 1;
+	constexpr uint32_t MESH_CACHE_FLAG_MESHLETS = 1 << 2;
+
+	std::string meshCachePath(const std::string &sourcePath);
+
+	//returns false if the cache is missing, stale or corrupted, the builder is left untouched in that case
+	bool readMeshCache(const std::string &cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t flags, LveModel::Builder &builder);
+	//failing to write is not fatal, we will just parse the obj again next launch
+	bool writeMeshCache(const std::string &cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t flags, const LveModel::Builder &builder);
+}
@@ -0,0 +1,268 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace wind
+{
+	namespace
+	{
+		//fifo cache emulated with insertion stamps : a vertex is cached while fewer than cacheSize
+		//other vertices got inserted after it
+		struct FifoCache
+		{
+			std::vector<uint32_t>	insertedAt;
+			uint32_t				clock;
+			uint32_t				size;
+
+			FifoCache(size_t vertexCount, uint32_t cacheSize) : insertedAt(vertexCount, 0), clock{cacheSize + 1}, size{cacheSize} {}
+
+			void reset() { clock += size + 1; } //everything now looks older than the cache
+
+			bool access(uint32_t vertex) //returns true on a miss
+			{
+				if (clock - insertedAt[vertex] <= size)
+					return false;
+				insertedAt[vertex] = clock++;
+				return true;
+			}
+		};
+
+		struct Cluster
+		{
+			uint32_t	firstTriangle;
+			uint32_t	triangleCount;
+			float		sortKey;
+		};
+
+		int64_t skipDeadEnd(std::vector<uint32_t> &deadEnd, const std::vector<uint32_t> &liveTriangles, size_t &cursor)
+		{
+			while (!deadEnd.empty()) //recently touched vertices first, they are the most likely to still be cached
+			{
+				uint32_t vertex = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveTriangles[vertex] > 0)
+					return vertex;
+			}
+			for (; cursor < liveTriangles.size(); cursor++) //then the next vertex in input order
+			{
+				if (liveTriangles[cursor] > 0)
+					return static_cast<int64_t>(cursor);
+			}
+			return -1;
+		}
+	}
+
+	VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize)
+	{
+		VertexCacheStats stats{};
+		if (indices.empty())
+			return stats;
+
+		FifoCache cache{vertexCount, cacheSize};
+		std::vector<char> used(vertexCount, 0);
+		size_t uniqueCount = 0;
+		for (uint32_t index : indices)
+		{
+			if (cache.access(index))
+				stats.transforms++;
+			if (!used[index])
+			{
+				used[index] = 1;
+				uniqueCount++;
+			}
+		}
+		stats.acmr = static_cast<float>(stats.transforms) / static_cast<float>(indices.size() / 3);
+		stats.atvr = static_cast<float>(stats.transforms) / static_cast<float>(uniqueCount);
+		return stats;
+	}
+
+	void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t> &clusterStarts)
+	{
+		clusterStarts.clear();
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		//vertex -> triangles adjacency packed in one array (offsets + list)
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (uint32_t index : indices)
+			liveTriangles[index]++;
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+			offsets[v + 1] = offsets[v] + liveTriangles[v];
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<char> emitted(triangleCount, 0);
+		std::vector<uint32_t> deadEnd;
+		deadEnd.reserve(indices.size());
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		int64_t timestamp = cacheSize + 1;
+		size_t cursor = 0;
+		int64_t fanning = skipDeadEnd(deadEnd, liveTriangles, cursor);
+		clusterStarts.push_back(0);
+		while (fanning >= 0)
+		{
+			//emit every triangle still around the fanning vertex
+			candidates.clear();
+			for (uint32_t i = offsets[fanning]; i < offsets[fanning + 1]; i++)
+			{
+				uint32_t triangle = adjacency[i];
+				if (emitted[triangle])
+					continue;
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t vertex = indices[triangle * 3 + k];
+					output.push_back(vertex);
+					deadEnd.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+					if (timestamp - cacheTime[vertex] > cacheSize)
+						cacheTime[vertex] = static_cast<uint32_t>(timestamp++);
+				}
+				emitted[triangle] = 1;
+			}
+
+			//next fanning vertex : the oldest candidate that will still be cached once its triangles are out
+			int64_t next = -1;
+			int64_t bestPriority = -1;
+			for (uint32_t vertex : candidates)
+			{
+				if (liveTriangles[vertex] == 0)
+					continue;
+				int64_t priority = 0;
+				int64_t age = timestamp - cacheTime[vertex];
+				if (age + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= cacheSize)
+					priority = age;
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					next = vertex;
+				}
+			}
+			if (next == -1)
+			{
+				next = skipDeadEnd(deadEnd, liveTriangles, cursor);
+				if (next >= 0)
+					clusterStarts.push_back(static_cast<uint32_t>(output.size() / 3)); //cache was lost, hard cluster boundary
+			}
+			fanning = next;
+		}
+		indices.swap(output);
+	}
+
+	void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<LveModel::Vertex> &vertices,
+		const std::vector<uint32_t> &clusterStarts, uint32_t cacheSize, float threshold)
+	{
+		const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		if (triangleCount == 0 || clusterStarts.empty())
+			return;
+
+		//soft split : cut a hard cluster as soon as its own acmr got close to the whole mesh acmr,
+		//the cut costs almost nothing in cache misses and gives the sort more freedom
+		const float targetAcmr = analyzeVertexCache(indices, vertices.size(), cacheSize).acmr * threshold;
+		std::vector<Cluster> clusters;
+		FifoCache cache{vertices.size(), cacheSize};
+		for (size_t c = 0; c < clusterStarts.size(); c++)
+		{
+			uint32_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+			uint32_t start = clusterStarts[c];
+			uint32_t misses = 0;
+			cache.reset();
+			for (uint32_t t = start; t < end; t++)
+			{
+				for (int k = 0; k < 3; k++)
+					misses += cache.access(indices[t * 3 + k]);
+				uint32_t count = t - start + 1;
+				if (t + 1 < end && static_cast<float>(misses) <= targetAcmr * static_cast<float>(count))
+				{
+					clusters.push_back({start, count, 0.f});
+					start = t + 1;
+					misses = 0;
+					cache.reset();
+				}
+			}
+			if (start < end)
+				clusters.push_back({start, end - start, 0.f});
+		}
+
+		//area weighted centroid and normal for every cluster and for the whole mesh
+		//geometric normals are flipped to agree with the obj normals so winding order does not matter
+		glm::vec3 meshCentroid{0.f};
+		float meshArea = 0.f;
+		std::vector<glm::vec3> clusterCentroids(clusters.size());
+		std::vector<glm::vec3> clusterNormals(clusters.size());
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			glm::vec3 centroid{0.f};
+			glm::vec3 normal{0.f};
+			float area = 0.f;
+			for (uint32_t t = clusters[c].firstTriangle; t < clusters[c].firstTriangle + clusters[c].triangleCount; t++)
+			{
+				const LveModel::Vertex &a = vertices[indices[t * 3 + 0]];
+				const LveModel::Vertex &b = vertices[indices[t * 3 + 1]];
+				const LveModel::Vertex &d = vertices[indices[t * 3 + 2]];
+				glm::vec3 faceNormal = glm::cross(b.position - a.position, d.position - a.position);
+				if (glm::dot(faceNormal, a.normal + b.normal + d.normal) < 0.f)
+					faceNormal = -faceNormal;
+				float faceArea = glm::length(faceNormal);
+				centroid += (a.position + b.position + d.position) * (faceArea / 3.f);
+				normal += faceNormal;
+				area += faceArea;
+			}
+			meshCentroid += centroid;
+			meshArea += area;
+			clusterCentroids[c] = area > 0.f ? centroid / area : vertices[indices[clusters[c].firstTriangle * 3]].position;
+			clusterNormals[c] = normal;
+		}
+		if (meshArea > 0.f)
+			meshCentroid /= meshArea;
+
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			float normalLength = glm::length(clusterNormals[c]);
+			glm::vec3 normal = normalLength > 0.f ? clusterNormals[c] / normalLength : glm::vec3{0.f};
+			clusters[c].sortKey = glm::dot(clusterCentroids[c] - meshCentroid, normal);
+		}
+
+		//clusters facing away from the center are the ones most likely to be in front, draw them first
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+		for (const auto &cluster : clusters)
+		{
+			output.insert(output.end(),
+				indices.begin() + cluster.firstTriangle * 3,
+				indices.begin() + (cluster.firstTriangle + cluster.triangleCount) * 3);
+		}
+		indices.swap(output);
+	}
+
+	void optimizeVertexFetch(std::vector<LveModel::Vertex> &vertices, std::vector<uint32_t> &indices)
+	{
+		const uint32_t unset = std::numeric_limits<uint32_t>::max();
+		std::vector<uint32_t> remap(vertices.size(), unset);
+		std::vector<LveModel::Vertex> reordered;
+		reordered.reserve(vertices.size());
+		for (uint32_t &index : indices)
+		{
+			if (remap[index] == unset)
+			{
+				remap[index] = static_cast<uint32_t>(reordered.size());
+				reordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+		vertices.swap(reordered);
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace wind
+{
+	//post transform cache numbers for a triangle list, simulated on a FIFO cache
+	struct VertexCacheStats
+	{
+		float		acmr = 0.f; //average cache miss ratio : vertex shader runs per triangle, 0.5 is the ideal, 3 the worst
+		float		atvr = 0.f; //average transform to vertex ratio : vertex shader runs per unique vertex, 1 is the ideal
+		uint32_t	transforms = 0;
+	};
+
+	constexpr uint32_t VERTEX_CACHE_SIZE = 16; //conservative fifo size, modern gpus do at least as well
+
+	VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+	//tipsify (Sander et al. 2007), reorders triangles for cache reuse in linear time
+	//clusterStarts receives the first triangle of every run that starts after a cache flush
+	void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t> &clusterStarts);
+
+	//splits the tipsify runs further where the cache is warm enough and sorts the clusters so the
+	//outward facing ones are drawn first, which lets early depth test kill more of what comes after
+	void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<LveModel::Vertex> &vertices,
+		const std::vector<uint32_t> &clusterStarts, uint32_t cacheSize, float threshold = 1.05f);
+
+	//renumbers vertices in the order the index buffer first touches them so fetches walk memory forward
+	//vertices nothing references are dropped
+	void optimizeVertexFetch(std::vector<LveModel::Vertex> &vertices, std::vector<uint32_t> &indices);
+}
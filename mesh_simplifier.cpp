@@ -0,0 +1,285 @@
+#include "mesh_simplifier.hpp"
+#include "weld_table.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace wind
+{
+	namespace
+	{
+		//symmetric 4x4 error matrix for the planes around a vertex, weight is the summed triangle area
+		//so evaluate() / weight is an area weighted mean squared distance to those planes
+		struct Quadric
+		{
+			double	xx = 0, xy = 0, xz = 0, xw = 0;
+			double	yy = 0, yz = 0, yw = 0;
+			double	zz = 0, zw = 0;
+			double	ww = 0;
+			double	weight = 0;
+
+			static Quadric fromPlane(glm::vec3 normal, float distance, double weight)
+			{
+				Quadric q;
+				double a = normal.x, b = normal.y, c = normal.z, d = distance;
+				q.xx = a * a * weight; q.xy = a * b * weight; q.xz = a * c * weight; q.xw = a * d * weight;
+				q.yy = b * b * weight; q.yz = b * c * weight; q.yw = b * d * weight;
+				q.zz = c * c * weight; q.zw = c * d * weight;
+				q.ww = d * d * weight;
+				q.weight = weight;
+				return q;
+			}
+
+			Quadric &operator+=(const Quadric &o)
+			{
+				xx += o.xx; xy += o.xy; xz += o.xz; xw += o.xw;
+				yy += o.yy; yz += o.yz; yw += o.yw;
+				zz += o.zz; zw += o.zw;
+				ww += o.ww;
+				weight += o.weight;
+				return *this;
+			}
+
+			double evaluate(glm::vec3 p) const
+			{
+				double x = p.x, y = p.y, z = p.z;
+				double e = x * x * xx + y * y * yy + z * z * zz
+					+ 2.0 * (x * y * xy + x * z * xz + y * z * yz)
+					+ 2.0 * (x * xw + y * yw + z * zw)
+					+ ww;
+				return e > 0.0 ? e : 0.0; //rounding can dip under zero
+			}
+		};
+
+		struct Collapse
+		{
+			uint32_t	from;
+			uint32_t	to;
+			float		cost; //squared distance
+		};
+
+		//collapse cost of moving "from" onto "to", the merged quadric is what "to" will carry afterwards
+		float collapseCost(const std::vector<Quadric> &quadrics, const std::vector<glm::vec3> &positions, uint32_t from, uint32_t to)
+		{
+			Quadric merged = quadrics[from];
+			merged += quadrics[to];
+			if (merged.weight <= 0.0)
+				return 0.f;
+			return static_cast<float>(merged.evaluate(positions[to]) / merged.weight);
+		}
+
+		//vertex at position "to" that should replace "vertex", the closest normal wins so flat shaded
+		//and seamed meshes keep mostly coherent attributes
+		uint32_t pickWedge(const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &wedgeOffsets,
+			const std::vector<uint32_t> &wedges, uint32_t vertex, uint32_t to)
+		{
+			uint32_t best = wedges[wedgeOffsets[to]];
+			float bestScore = -std::numeric_limits<float>::max();
+			for (uint32_t i = wedgeOffsets[to]; i < wedgeOffsets[to + 1]; i++)
+			{
+				const LveModel::Vertex &candidate = vertices[wedges[i]];
+				float score = glm::dot(candidate.normal, vertices[vertex].normal) - glm::length(candidate.uv - vertices[vertex].uv);
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = wedges[i];
+				}
+			}
+			return best;
+		}
+	}
+
+	std::vector<uint32_t> simplifyMesh(const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices,
+		size_t targetIndexCount, float maxError, float &error)
+	{
+		error = 0.f;
+		std::vector<uint32_t> result = indices;
+		if (indices.size() <= targetIndexCount || vertices.empty())
+			return result;
+
+		//positions shared by several vertices (seams) are one node of the graph we collapse
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> remap(vertices.size());
+		{
+			WeldTable<glm::vec3> uniquePositions{positions, vertices.size()};
+			for (size_t i = 0; i < vertices.size(); i++)
+				remap[i] = uniquePositions.weld(vertices[i].position);
+		}
+		const uint32_t positionCount = static_cast<uint32_t>(positions.size());
+
+		std::vector<uint32_t> wedgeOffsets(positionCount + 1, 0);
+		for (uint32_t position : remap)
+			wedgeOffsets[position + 1]++;
+		for (uint32_t p = 0; p < positionCount; p++)
+			wedgeOffsets[p + 1] += wedgeOffsets[p];
+		std::vector<uint32_t> wedges(vertices.size());
+		{
+			std::vector<uint32_t> cursor(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+			for (uint32_t v = 0; v < vertices.size(); v++)
+				wedges[cursor[remap[v]]++] = v;
+		}
+
+		std::vector<Quadric> quadrics(positionCount);
+		for (size_t i = 0; i + 2 < result.size(); i += 3)
+		{
+			glm::vec3 p0 = positions[remap[result[i]]], p1 = positions[remap[result[i + 1]]], p2 = positions[remap[result[i + 2]]];
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+			if (length == 0.f)
+				continue;
+			normal /= length;
+			Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, p0), length * 0.5);
+			for (int k = 0; k < 3; k++)
+				quadrics[remap[result[i + k]]] += plane;
+		}
+
+		//an edge used by a single triangle is a border, its end points are never moved
+		std::vector<bool> border(positionCount, false);
+		{
+			std::vector<uint64_t> edges;
+			edges.reserve(result.size());
+			for (size_t i = 0; i + 2 < result.size(); i += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t a = remap[result[i + k]], b = remap[result[i + (k + 1) % 3]];
+					if (a == b)
+						continue;
+					edges.push_back(static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			for (size_t i = 0; i < edges.size();)
+			{
+				size_t j = i;
+				while (j < edges.size() && edges[j] == edges[i])
+					j++;
+				if (j - i == 1)
+				{
+					border[edges[i] >> 32] = true;
+					border[edges[i] & 0xffffffffu] = true;
+				}
+				i = j;
+			}
+		}
+
+		const float maxCost = maxError * maxError;
+		std::vector<uint32_t> adjacencyOffsets(positionCount + 1);
+		std::vector<uint32_t> adjacency;
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> collapseTarget(positionCount);
+		std::vector<bool> locked(positionCount);
+
+		//each pass collapses a batch of independent edges cheapest first, then rebuilds the triangles
+		while (result.size() > targetIndexCount)
+		{
+			const size_t triangleCount = result.size() / 3;
+
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (uint32_t corner : result)
+				adjacencyOffsets[remap[corner] + 1]++;
+			for (uint32_t p = 0; p < positionCount; p++)
+				adjacencyOffsets[p + 1] += adjacencyOffsets[p];
+			adjacency.resize(result.size());
+			{
+				std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < result.size(); i++)
+					adjacency[cursor[remap[result[i]]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t a = remap[result[i + k]], b = remap[result[i + (k + 1) % 3]];
+					if (a > b) //interior edges show up once per side, the later copy fails on the lock
+						std::swap(a, b);
+					float costAB = border[a] ? std::numeric_limits<float>::max() : collapseCost(quadrics, positions, a, b);
+					float costBA = border[b] ? std::numeric_limits<float>::max() : collapseCost(quadrics, positions, b, a);
+					if (costAB == std::numeric_limits<float>::max() && costBA == std::numeric_limits<float>::max())
+						continue;
+					if (costAB <= costBA)
+						collapses.push_back({a, b, costAB});
+					else
+						collapses.push_back({b, a, costBA});
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse &l, const Collapse &r) { return l.cost < r.cost; });
+
+			std::fill(locked.begin(), locked.end(), false);
+			for (uint32_t p = 0; p < positionCount; p++)
+				collapseTarget[p] = p;
+
+			size_t removedTriangles = 0;
+			size_t collapsed = 0;
+			const size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+			for (const Collapse &collapse : collapses)
+			{
+				if (collapse.cost > maxCost || removedTriangles >= trianglesToRemove)
+					break;
+				if (locked[collapse.from] || locked[collapse.to])
+					continue;
+
+				//reject the collapse if a surviving triangle around "from" would flip
+				bool flips = false;
+				size_t dying = 0;
+				for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; a++)
+				{
+					const uint32_t *triangle = &result[adjacency[a] * 3];
+					uint32_t corners[3] = {remap[triangle[0]], remap[triangle[1]], remap[triangle[2]]};
+					if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+					{
+						dying++;
+						continue;
+					}
+					glm::vec3 before = glm::cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+					for (uint32_t &corner : corners)
+					{
+						if (corner == collapse.from)
+							corner = collapse.to;
+					}
+					glm::vec3 after = glm::cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+					flips = glm::dot(before, after) <= 0.f;
+				}
+				if (flips)
+					continue;
+
+				//everything around "from" changes, lock the whole ring so later collapses in this pass see valid triangles
+				for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+				{
+					const uint32_t *triangle = &result[adjacency[a] * 3];
+					for (int k = 0; k < 3; k++)
+						locked[remap[triangle[k]]] = true;
+				}
+				collapseTarget[collapse.from] = collapse.to;
+				quadrics[collapse.to] += quadrics[collapse.from];
+				error = std::max(error, std::sqrt(collapse.cost));
+				removedTriangles += dying;
+				collapsed++;
+			}
+			if (collapsed == 0)
+				break;
+
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				uint32_t triangle[3];
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t vertex = result[i + k];
+					uint32_t target = collapseTarget[remap[vertex]];
+					triangle[k] = target == remap[vertex] ? vertex : pickWedge(vertices, wedgeOffsets, wedges, vertex, target);
+				}
+				if (remap[triangle[0]] == remap[triangle[1]] || remap[triangle[1]] == remap[triangle[2]] || remap[triangle[0]] == remap[triangle[2]])
+					continue;
+				result[write++] = triangle[0];
+				result[write++] = triangle[1];
+				result[write++] = triangle[2];
+			}
+			result.resize(write);
+		}
+		return result;
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace wind
+{
+	//edge collapse simplifier driven by quadric error metrics (Garland & Heckbert 1997)
+	//collapses always move a vertex onto one of its neighbours, no vertex is created, so every
+	//simplified index list still points into the original vertex buffer
+	//collapses are done on positions, attribute seams (flat shading, uv cuts) move together
+	//open borders are never moved so silhouettes of cut meshes stay put
+	//stops at targetIndexCount or when the next collapse would deviate more than maxError
+	//error receives the largest deviation introduced, in object space units
+	std::vector<uint32_t> simplifyMesh(const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices,
+		size_t targetIndexCount, float maxError, float &error);
+}
@@ -0,0 +1,108 @@
+#include "meshlets.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wind
+{
+	namespace
+	{
+		//a cone wider than this never passes the backface test, stop growing it before that
+		constexpr float MIN_CONE_DOT = 0.4f;
+
+		//unit triangle normal, flipped to agree with the obj vertex normals when there are some
+		glm::vec3 facing(const std::vector<LveModel::Vertex> &vertices, const uint32_t *triangle)
+		{
+			const LveModel::Vertex &v0 = vertices[triangle[0]], &v1 = vertices[triangle[1]], &v2 = vertices[triangle[2]];
+			glm::vec3 normal = glm::cross(v1.position - v0.position, v2.position - v0.position);
+			float length = glm::length(normal);
+			if (length == 0.f)
+				return glm::vec3{0.f};
+			normal /= length;
+			if (glm::dot(normal, v0.normal + v1.normal + v2.normal) < 0.f)
+				normal = -normal;
+			return normal;
+		}
+
+		void finishMeshlet(LveModel::Meshlet &meshlet, const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices,
+			const std::vector<uint32_t> &meshletVertices, glm::vec3 normalSum)
+		{
+			glm::vec3 boundsMin = vertices[meshletVertices[0]].position, boundsMax = boundsMin;
+			for (uint32_t vertex : meshletVertices)
+			{
+				boundsMin = glm::min(boundsMin, vertices[vertex].position);
+				boundsMax = glm::max(boundsMax, vertices[vertex].position);
+			}
+			meshlet.center = (boundsMin + boundsMax) * 0.5f;
+			meshlet.radius = 0.f;
+			for (uint32_t vertex : meshletVertices)
+				meshlet.radius = std::max(meshlet.radius, glm::length(vertices[vertex].position - meshlet.center));
+
+			//cone axis is the average facing, the cutoff comes from the triangle that strays the most
+			float axisLength = glm::length(normalSum);
+			meshlet.coneAxis = axisLength > 0.f ? normalSum / axisLength : glm::vec3{0.f, 0.f, 1.f};
+			float minDot = axisLength > 0.f ? 1.f : -1.f;
+			for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+			{
+				glm::vec3 normal = facing(vertices, &indices[i]);
+				if (normal != glm::vec3{0.f})
+					minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+			}
+			meshlet.coneCutoff = minDot <= 0.1f ? 1.f : std::sqrt(1.f - minDot * minDot);
+		}
+	}
+
+	std::vector<LveModel::Meshlet> clusterMeshlets(const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices,
+		size_t indexCount, uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		std::vector<LveModel::Meshlet> meshlets;
+		std::vector<uint32_t> meshletVertices;
+		std::vector<uint32_t> usedBy(vertices.size(), UINT32_MAX); //meshlet that last added each vertex
+		LveModel::Meshlet current{};
+		glm::vec3 normalSum{0.f};
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const uint32_t meshletId = static_cast<uint32_t>(meshlets.size());
+			uint32_t newVertices = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				if (usedBy[indices[i + k]] != meshletId)
+					newVertices++;
+			}
+			glm::vec3 normal = facing(vertices, &indices[i]);
+
+			bool full = meshletVertices.size() + newVertices > maxVertices || current.indexCount / 3 >= maxTriangles;
+			//only start judging the cone once the cluster is big enough to have a stable average
+			bool bends = current.indexCount / 3 >= maxTriangles / 4 && glm::length(normalSum) > 0.f
+				&& glm::dot(normal, glm::normalize(normalSum)) < MIN_CONE_DOT;
+			if (current.indexCount > 0 && (full || bends))
+			{
+				finishMeshlet(current, vertices, indices, meshletVertices, normalSum);
+				meshlets.push_back(current);
+				current = LveModel::Meshlet{};
+				current.firstIndex = static_cast<uint32_t>(i);
+				meshletVertices.clear();
+				normalSum = glm::vec3{0.f};
+			}
+
+			const uint32_t id = static_cast<uint32_t>(meshlets.size());
+			for (int k = 0; k < 3; k++)
+			{
+				if (usedBy[indices[i + k]] != id)
+				{
+					usedBy[indices[i + k]] = id;
+					meshletVertices.push_back(indices[i + k]);
+				}
+			}
+			current.indexCount += 3;
+			normalSum += normal;
+		}
+		if (current.indexCount > 0)
+		{
+			finishMeshlet(current, vertices, indices, meshletVertices, normalSum);
+			meshlets.push_back(current);
+		}
+		return meshlets;
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace wind
+{
+	//greedy clustering of the first indexCount indices into meshlets, triangles keep their order so every
+	//meshlet is a contiguous index range (run it on cache optimized indices, neighbours are already close)
+	//a meshlet is closed when it runs out of vertices or triangles, or when a new triangle would widen
+	//its normal cone past the point where backface culling it still works
+	std::vector<LveModel::Meshlet> clusterMeshlets(const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices,
+		size_t indexCount, uint32_t maxVertices = LveModel::MESHLET_MAX_VERTICES, uint32_t maxTriangles = LveModel::MESHLET_MAX_TRIANGLES);
+}
@@ -1,127 +1,201 @@
 #include "model.hpp"
-#include "utils.hpp"
+#include "upload_batcher.hpp"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
-#include <unordered_map>
+#include <algorithm>
 #include <cstring>
 #include <cassert>
 #include <iostream>
 
 
-namespace std
+namespace wind
 {
-	template <>
-	struct hash<wind::LveModel::Vertex>
+	namespace
 	{
-		size_t operator()(wind::LveModel::Vertex const &vertex) const
+		//octahedral mapping : project on the |x|+|y|+|z| = 1 octahedron, fold the lower half over the upper one
+		glm::vec2 octEncode(glm::vec3 n)
 		{
-			size_t seed = 0;
-			wind::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
+			float l1 = glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+			if (l1 == 0.f) //obj without normals
+				return glm::vec2{0.f};
+			n /= l1;
+			glm::vec2 e{n.x, n.y};
+			if (n.z < 0.f)
+			{
+				e.x = (1.f - glm::abs(n.y)) * (n.x >= 0.f ? 1.f : -1.f);
+				e.y = (1.f - glm::abs(n.x)) * (n.y >= 0.f ? 1.f : -1.f);
+			}
+			return e;
 		}
-	};
-}
 
-namespace wind
-{
-	LveModel::LveModel(EngineDevice &device, const LveModel::Builder &builder) : device{device}
-	{
-		createVertexBuffers(builder.vertices);
-		createIndexBuffers(builder.indices);
+		int16_t packSnorm16(float value)
+		{
+			return static_cast<int16_t>(glm::packSnorm1x16(value));
+		}
+
+		uint8_t packUnorm8(float value)
+		{
+			return static_cast<uint8_t>(glm::packUnorm1x8(value));
+		}
 	}
 
-	LveModel::~LveModel()
+	LveModel::LveModel(EngineDevice &device, GeometryPool &geometry, const LveModel::Builder &builder, UploadBatcher &upload)
+		: device{device}, geometry{geometry}
 	{
-		destroy_buffer(vertexBuffer, device);
-		if (hasIndexBuffer)
+		try
+		{
+			createVertexBuffers(builder, upload);
+			createIndexBuffers(builder.indices, upload);
+		}
+		catch (...) //pool full, give back the half we got
 		{
-			destroy_buffer(indexBuffer, device);
+			geometry.free(range);
+			throw;
 		}
+		createLods(builder);
+	}
+
+	LveModel::~LveModel()
+	{
+		geometry.free(range);
 	}
 
 
-	std::unique_ptr<LveModel> LveModel::createModel_from_file(EngineDevice &device, const std::string &filepath)
+	std::unique_ptr<LveModel> LveModel::createModel_from_file(EngineDevice &device, GeometryPool &geometry, const std::string &filepath,
+		UploadBatcher &upload, VertexFormat format, ThreadPool *parseThreads)
 	{
 		Builder builder{};
 
+		builder.vertexFormat = format;
+		builder.parseThreads = parseThreads;
 		builder.loadModel(filepath);
-		std::cout << "Vertices : " << builder.vertices.size() << std::endl;
-		return std::make_unique<LveModel>(device, builder);
+		std::cout << "Vertices : " << builder.vertices.size()
+			<< " (" << builder.vertices.size() * vertexStride(format) << " bytes on the gpu, "
+			<< builder.vertices.size() * sizeof(Vertex) << " as full floats)" << std::endl;
+		return std::make_unique<LveModel>(device, geometry, builder, upload);
 	}
 
 	void LveModel::bind(VkCommandBuffer commandBuffer)
 	{
-		VkBuffer	buffers[] = {vertexBuffer.buffer};
-		VkDeviceSize	offsets[] = {0};
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+		geometry.bindVertices(commandBuffer);
 		if (hasIndexBuffer)
-			vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+			geometry.bindIndices(commandBuffer, indexType);
 	}
 
-	void LveModel::draw(VkCommandBuffer commandBuffer)
+	void LveModel::draw(VkCommandBuffer commandBuffer, uint32_t lod, uint32_t instanceCount, uint32_t firstInstance)
 	{
 		if (hasIndexBuffer)
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+		{
+			const LodLevel &level = lods[std::min(lod, getLodCount() - 1)];
+			vkCmdDrawIndexed(commandBuffer, level.indexCount, instanceCount, range.firstIndex() + level.firstIndex, range.firstVertex(), firstInstance);
+		}
 		else
-			vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+			vkCmdDraw(commandBuffer, vertexCount, instanceCount, static_cast<uint32_t>(range.firstVertex()), firstInstance);
 	}
 
-	void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices)
+	void LveModel::createVertexBuffers(const Builder &builder, UploadBatcher &upload)
 	{
-		vertexCount = static_cast<uint32_t>(vertices.size());
-		assert(vertexCount >= 3 && "Vertex count should be at least 3");
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
+		vertexFormat = builder.vertexFormat;
+		if (vertexFormat == VertexFormat::Full)
+		{
+			createVertexBuffers(builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size()), sizeof(Vertex), upload);
+			return;
+		}
 
-		t_buffer stagingBuffer;
-		initialise_buffer(stagingBuffer,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			device, bufferSize);
+		//positions are stored relative to the aabb, -1..1 on every axis, a flat axis keeps a scale of 1
+		glm::vec3 center = (builder.boundsMin + builder.boundsMax) * 0.5f;
+		glm::vec3 halfExtent = (builder.boundsMax - builder.boundsMin) * 0.5f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (halfExtent[axis] <= 0.f)
+				halfExtent[axis] = 1.f;
+		}
+		if (vertexFormat == VertexFormat::Quantized)
+			dequantizeMatrix = glm::scale(glm::translate(glm::mat4{1.f}, center), halfExtent);
 
-		vkMapMemory(device.device(), stagingBuffer.memory, 0, bufferSize, 0, &stagingBuffer.data); //map une partie de la mémoire du Cpu pour matcher la mémoire du gpu dans enginedevice
-		memcpy(stagingBuffer.data, vertices.data(), static_cast<size_t>(bufferSize));
-		vkUnmapMemory(device.device(), stagingBuffer.memory);
+		std::vector<CompactVertex> compact(builder.vertices.size());
+		for (size_t i = 0; i < builder.vertices.size(); i++)
+		{
+			const Vertex &vertex = builder.vertices[i];
+			CompactVertex &out = compact[i];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (vertexFormat == VertexFormat::Quantized)
+					out.position[axis] = glm::packSnorm1x16((vertex.position[axis] - center[axis]) / halfExtent[axis]);
+				else
+					out.position[axis] = glm::packHalf1x16(vertex.position[axis]);
+			}
+			out.position[3] = 0;
+			glm::vec2 octahedral = octEncode(vertex.normal);
+			out.normal[0] = packSnorm16(octahedral.x);
+			out.normal[1] = packSnorm16(octahedral.y);
+			out.color[0] = packUnorm8(vertex.color.x);
+			out.color[1] = packUnorm8(vertex.color.y);
+			out.color[2] = packUnorm8(vertex.color.z);
+			out.color[3] = 255;
+			out.uv[0] = glm::packHalf1x16(vertex.uv.x);
+			out.uv[1] = glm::packHalf1x16(vertex.uv.y);
+		}
+		createVertexBuffers(compact.data(), static_cast<uint32_t>(compact.size()), sizeof(CompactVertex), upload);
+	}
 
-		initialise_buffer(vertexBuffer,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			device, bufferSize);
+	void LveModel::createVertexBuffers(const void *vertexData, uint32_t count, uint32_t stride, UploadBatcher &upload)
+	{
+		vertexCount = count;
+		assert(vertexCount >= 3 && "Vertex count should be at least 3");
+		VkDeviceSize bufferSize = static_cast<VkDeviceSize>(stride) * vertexCount;
 
-		device.copyBuffer(stagingBuffer.buffer, vertexBuffer.buffer, bufferSize); 
-		destroy_buffer(stagingBuffer, device);
+		geometry.allocateVertices(range, bufferSize, stride);
+		upload.copyToBuffer(geometry.getVertexBuffer(), range.vertexOffset, vertexData, bufferSize); //only recorded, see the constructor
 	}
 
-	void LveModel::createIndexBuffers(const std::vector<u_int32_t> &indices)
+	void LveModel::createIndexBuffers(const std::vector<u_int32_t> &indices, UploadBatcher &upload)
 	{
 		indexCount = static_cast<uint32_t>(indices.size());
 		hasIndexBuffer = indexCount > 0;
 		if (!hasIndexBuffer)
 			return;
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+		//the vertex buffer is created first, if every index fits in 16 bits we halve the index buffer
+		std::vector<uint16_t> shortIndices;
+		const void *indexData = indices.data();
+		indexType = VK_INDEX_TYPE_UINT32;
+		if (vertexCount <= UINT16_MAX + 1u)
+		{
+			indexType = VK_INDEX_TYPE_UINT16;
+			shortIndices.assign(indices.begin(), indices.end());
+			indexData = shortIndices.data();
+		}
 
-		t_buffer stagingBuffer;
-		initialise_buffer(stagingBuffer,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			device, bufferSize);
-		
-		//void *data;
-		vkMapMemory(device.device(), stagingBuffer.memory, 0, bufferSize, 0, &stagingBuffer.data); //map une partie de la mémoire du Cpu pour matcher la mémoire du gpu dans enginedevice
-		memcpy(stagingBuffer.data, indices.data(), static_cast<size_t>(bufferSize));
-		vkUnmapMemory(device.device(), stagingBuffer.memory);
+		VkDeviceSize bufferSize = static_cast<VkDeviceSize>(indexSize(indexType)) * indexCount;
 
-		initialise_buffer(indexBuffer,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			device, bufferSize);
+		geometry.allocateIndices(range, bufferSize, indexSize(indexType));
+		upload.copyToBuffer(geometry.getIndexBuffer(), range.indexOffset, indexData, bufferSize);
+	}
 
-		device.copyBuffer(stagingBuffer.buffer, indexBuffer.buffer, bufferSize);
-		destroy_buffer(stagingBuffer, device);
+	void LveModel::createLods(const Builder &builder)
+	{
+		lods = builder.lods;
+		if (lods.empty()) //hand made builder or no index buffer, one level covering everything
+			lods.push_back({0, hasIndexBuffer ? indexCount : vertexCount, 0.f});
+
+		if (hasIndexBuffer)
+			meshlets = builder.meshlets;
+
+		boundsMin = builder.boundsMin;
+		boundsMax = builder.boundsMax;
+		boundsCenter = (builder.boundsMin + builder.boundsMax) * 0.5f;
+		boundsRadius = glm::length(builder.boundsMax - builder.boundsMin) * 0.5f;
+
+		if (lods.size() > 1)
+		{
+			std::cout << "Lods :";
+			for (const auto &lod : lods)
+				std::cout << " " << lod.indexCount / 3 << " tris (error " << lod.error << ")";
+			std::cout << std::endl;
+		}
 	}
 
 	std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions()
@@ -145,62 +219,36 @@ namespace wind
 		return attributeDescriptions;
 	}
 
-	void LveModel::Builder::loadModel(const std::string &filepath)
+	std::vector<VkVertexInputAttributeDescription> LveModel::CompactVertex::getAttributeDescriptions(VertexFormat format)
 	{
-		tinyobj::attrib_t attrib; //stores textures coord, position, color, normal
-		std::vector<tinyobj::shape_t> shapes;//index values
-		std::vector<tinyobj::material_t> materials;
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 
-		std::string warn, error;
+		//same locations as Vertex so the fragment side does not care, the compact vertex shader decodes the normal
+		VkFormat positionFormat = format == VertexFormat::Quantized ? VK_FORMAT_R16G16B16A16_SNORM : VK_FORMAT_R16G16B16A16_SFLOAT;
+		attributeDescriptions.push_back({0, 0, positionFormat, offsetof(CompactVertex, position)});
+		attributeDescriptions.push_back({1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactVertex, color)});
+		attributeDescriptions.push_back({2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal)});
+		attributeDescriptions.push_back({3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, uv)});
 
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &error, filepath.c_str()))
-			throw std::runtime_error(warn + error);
-		vertices.clear();
-		indices.clear();
+		return attributeDescriptions;
+	}
 
-		std::unordered_map<Vertex, u_int32_t> unique_vertices{};
-		for (const auto &shape : shapes)
-		{
-			for (const auto &mesh_index : shape.mesh.indices)
-			{
-				Vertex vertex{};
-				if (mesh_index.vertex_index >= 0) //if value is negative then no index was provided
-				{
-					vertex.position = {
-						attrib.vertices[3 * mesh_index.vertex_index + 0],
-						attrib.vertices[3 * mesh_index.vertex_index + 1],
-						attrib.vertices[3 * mesh_index.vertex_index + 2]
-					};
-
-					vertex.color = {
-						attrib.colors[3 * mesh_index.vertex_index + 0],
-						attrib.colors[3 * mesh_index.vertex_index + 1],
-						attrib.colors[3 * mesh_index.vertex_index + 2]
-					};
-
-				}
-				if (mesh_index.normal_index >= 0) //if value is negative then no index was provided
-				{
-					vertex.normal = {
-						attrib.normals[3 * mesh_index.normal_index + 0],
-						attrib.normals[3 * mesh_index.normal_index + 1],
-						attrib.normals[3 * mesh_index.normal_index + 2]
-					};
-				}
-				if (mesh_index.texcoord_index >= 0) //if value is negative then no index was provided
-				{
-					vertex.uv = {
-						attrib.texcoords[2 * mesh_index.texcoord_index + 0],
-						attrib.texcoords[2 * mesh_index.texcoord_index + 1]
-					};
-				}
-				if (unique_vertices.count(vertex) == 0) //check if vertex is new
-				{
-					unique_vertices[vertex] = static_cast<u_int32_t>(vertices.size());//to remember his position //this line calls our hashcombine function
-					vertices.push_back(vertex);
-				}
-				indices.push_back(unique_vertices[vertex]); //give the right position to the indices vector
-			}
-		}
+	uint32_t LveModel::vertexStride(VertexFormat format)
+	{
+		return format == VertexFormat::Full ? sizeof(Vertex) : sizeof(CompactVertex);
+	}
+
+	std::vector<VkVertexInputBindingDescription> LveModel::getBindingDescriptions(VertexFormat format)
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions = Vertex::getBindingDescriptions();
+		bindingDescriptions[0].stride = vertexStride(format);
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> LveModel::getAttributeDescriptions(VertexFormat format)
+	{
+		if (format == VertexFormat::Full)
+			return Vertex::getAttributeDescriptions();
+		return CompactVertex::getAttributeDescriptions(format);
 	}
 }
\ No newline at end of file
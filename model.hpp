@@ -7,13 +7,26 @@
 #include <memory>
 #include <vector>
 #include "initialise_buffers.hpp"
+#include "geometry_pool.hpp"
 
 
 namespace wind 
 {
+	class UploadBatcher;
+	class ThreadPool;
+
 	class LveModel
 	{
 		public:
+			//how the vertex buffer is laid out on the gpu, the Builder always works on full Vertex
+			enum class VertexFormat
+			{
+				Full, //Vertex as is, 44 bytes
+				Quantized, //CompactVertex, snorm16 position relative to the mesh bounds, 20 bytes
+				HalfFloat, //CompactVertex, half float position, 20 bytes
+			};
+			static constexpr int VERTEX_FORMAT_COUNT = 3;
+
 			struct Vertex
 			{
 				glm::vec3	position{};
@@ -31,37 +44,129 @@ namespace wind
 				}
 			};
 
+			//shared by both compact formats, only the position encoding changes
+			struct CompactVertex
+			{
+				uint16_t	position[4]; //snorm16 or half depending on the format, w is padding
+				int16_t		normal[2]; //octahedral encoded unit normal, snorm16
+				uint8_t		color[4]; //unorm8, a unused
+				uint16_t	uv[2]; //half float
+
+				static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format);
+			};
+
+			//one level of detail, a range of the shared index buffer
+			struct LodLevel
+			{
+				uint32_t	firstIndex;
+				uint32_t	indexCount;
+				float		error; //largest deviation from the full mesh, object space units
+			};
+			static constexpr uint32_t MAX_LOD_COUNT = 5;
+
+			//a small cluster of lod 0 triangles with what is needed to cull it as a whole
+			struct Meshlet
+			{
+				glm::vec3	center; //bounding sphere, object space
+				float		radius;
+				glm::vec3	coneAxis; //average facing of the triangles
+				float		coneCutoff; //sin of the cone spread, 1 when the cluster faces too many ways to ever be backfacing
+				uint32_t	firstIndex;
+				uint32_t	indexCount;
+			};
+			static constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+			static constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(VertexFormat format);
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format);
+			static uint32_t vertexStride(VertexFormat format);
+
 			struct Builder
 			{
 				std::vector<Vertex> vertices{}; //to build/link our vertex buffer and index buffer
-				std::vector<uint32_t> indices{};
-
-				void loadModel (const std::string & filepath);
+				std::vector<uint32_t> indices{}; //every lod back to back, lod 0 first
+				std::vector<LodLevel> lods{}; //empty means the whole index buffer is a single level
+				std::vector<Meshlet> meshlets{}; //clusters covering lod 0 in index order, empty for small meshes
+				glm::vec3 boundsMin{}; //object space aabb, filled at import and stored in the mesh cache
+				glm::vec3 boundsMax{};
+				bool optimizeForGpu = true; //run the vertex cache / overdraw / fetch reordering at import
+				bool generateLods = true; //simplified levels appended to the index buffer at import
+				bool generateMeshlets = true; //cluster lod 0 so the renderer can cull parts of the mesh
+				VertexFormat vertexFormat = VertexFormat::Full; //encoding used when the model gets uploaded
+				ThreadPool *parseThreads = nullptr; //splits the obj parse, the calling thread does it all without one
+
+				void loadModel (const std::string & filepath); //goes through the .wmesh cache when it is up to date
+				void parseObj (const std::string & filepath);
+				void computeBounds();
+				void optimize(); //reorders triangles and vertices, the mesh itself does not change
+				void buildLods(); //needs the bounds, halves the triangle count per level
+				void buildMeshlets(); //after buildLods, only looks at lod 0
 			};
 
-			LveModel(EngineDevice &device, const LveModel::Builder &builder);
+			//vertices and indices go to ranges of the shared geometry pool, which must outlive the model
+			//the copies are only recorded into upload, the model is usable once that batch has completed
+			//if this throws, copies recorded before it may already be in the open batch, see UploadBatcher::discard
+			LveModel(EngineDevice &device, GeometryPool &geometry, const LveModel::Builder &builder, UploadBatcher &upload);
 			~LveModel();
 			
 			LveModel(const LveModel & ) = delete;
 			LveModel& operator=(const LveModel & ) = delete;
 
 
-			static std::unique_ptr<LveModel> createModel_from_file(EngineDevice &device, const std::string &filepath);
+			static std::unique_ptr<LveModel> createModel_from_file(EngineDevice &device, GeometryPool &geometry, const std::string &filepath,
+				UploadBatcher &upload, VertexFormat format = VertexFormat::Full, ThreadPool *parseThreads = nullptr);
 
+			//binds the pool buffers, draws of models sharing the pool and the index type don't need it again
 			void bind(VkCommandBuffer commandBuffer);
-			void draw(VkCommandBuffer commandBuffer);
+			//firstInstance picks the object data entry, see SimpleRenderSystem
+			void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+			GeometryPool &getGeometryPool() const { return geometry; }
+			//where the model sits in the pool buffers, add them to its own firstIndex / vertex indices
+			uint32_t getFirstIndex() const { return range.firstIndex(); }
+			int32_t getVertexOffset() const { return range.firstVertex(); }
+			bool hasIndices() const { return hasIndexBuffer; }
+
+			VertexFormat getVertexFormat() const { return vertexFormat; }
+			//maps the stored positions back to object space, fold it into the model matrix (identity unless Quantized)
+			const glm::mat4 &getDequantizeMatrix() const { return dequantizeMatrix; }
+			VkDeviceSize getVertexBufferSize() const { return static_cast<VkDeviceSize>(vertexCount) * vertexStride(vertexFormat); }
+			VkIndexType getIndexType() const { return indexType; }
+			uint32_t getIndexCount() const { return hasIndexBuffer ? indexCount : 0; }
+			VkDeviceSize getIndexBufferSize() const { return static_cast<VkDeviceSize>(getIndexCount()) * indexSize(indexType); }
+			static uint32_t indexSize(VkIndexType type) { return type == VK_INDEX_TYPE_UINT16 ? 2 : 4; }
+			uint32_t getLodCount() const { return static_cast<uint32_t>(lods.size()); }
+			const LodLevel &getLod(uint32_t lod) const { return lods[lod]; }
+			//object space aabb from the builder, and the bounding sphere around it
+			glm::vec3 getBoundsMin() const { return boundsMin; }
+			glm::vec3 getBoundsMax() const { return boundsMax; }
+			glm::vec3 getBoundsCenter() const { return boundsCenter; }
+			float getBoundsRadius() const { return boundsRadius; }
+			const std::vector<Meshlet> &getMeshlets() const { return meshlets; }
 
 		private:
 			EngineDevice	&device;
 
-			t_buffer 		vertexBuffer{}; //t_buffer is vkbuffer and vkdevicememory together
+			GeometryPool	&geometry;
+			GeometryPool::Range range{}; //the pool updates it when it compacts
 			uint32_t		vertexCount;
+			VertexFormat	vertexFormat = VertexFormat::Full;
+			glm::mat4		dequantizeMatrix{1.f};
 
-			t_buffer		indexBuffer{};
 			uint32_t		indexCount;
 			bool			hasIndexBuffer = false;
-
-			void createVertexBuffers(const std::vector<Vertex> &vertices);
-			void createIndexBuffers(const std::vector<u_int32_t> &indices);
+			VkIndexType		indexType = VK_INDEX_TYPE_UINT32; //uint16 when every vertex is reachable with 16 bits
+			std::vector<LodLevel>	lods; //never empty once built
+			std::vector<Meshlet>	meshlets;
+
+			glm::vec3		boundsMin{0.f};
+			glm::vec3		boundsMax{0.f};
+			glm::vec3		boundsCenter{0.f};
+			float			boundsRadius = 0.f;
+
+			void createVertexBuffers(const Builder &builder, UploadBatcher &upload);
+			void createVertexBuffers(const void *vertexData, uint32_t count, uint32_t stride, UploadBatcher &upload);
+			void createIndexBuffers(const std::vector<u_int32_t> &indices, UploadBatcher &upload);
+			void createLods(const Builder &builder);
 	};
 }
\ No newline at end of file
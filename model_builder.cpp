@@ -0,0 +1,173 @@
+#include "model.hpp"
+#include "utils.hpp"
+#include "mapped_file.hpp"
+#include "mesh_cache.hpp"
+#include "obj_parser.hpp"
+#include "weld_table.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlets.hpp"
+
+#include <iostream>
+
+//everything that turns a file into a Builder lives here, nothing in this file touches the gpu
+
+namespace wind
+{
+	static_assert(sizeof(LveModel::Vertex) == 11 * sizeof(float), "Vertex must stay padding free, it is welded and cached as raw bytes");
+
+	constexpr size_t LOD_MIN_TRIANGLES = 32; //under that a level does not save anything worth a draw range
+	constexpr float LOD_MAX_RELATIVE_ERROR = 0.1f; //of the aabb diagonal, coarser than that the silhouette is gone
+	constexpr size_t MESHLET_MIN_TRIANGLES = 4 * LveModel::MESHLET_MAX_TRIANGLES; //a handful of clusters is not worth culling
+
+	void LveModel::Builder::loadModel(const std::string &filepath)
+	{
+		uint64_t sourceHash;
+		uint64_t sourceSize;
+		{
+			MappedFile source;
+			if (!source.open(filepath))
+				throw std::runtime_error("failed to open file " + filepath);
+			sourceHash = hashBytes(source.data(), source.size());
+			sourceSize = source.size();
+		}
+
+		const std::string cachePath = meshCachePath(filepath);
+		const uint32_t importFlags = (optimizeForGpu ? MESH_CACHE_FLAG_OPTIMIZED : 0) | (generateLods ? MESH_CACHE_FLAG_LODS : 0)
+			| (generateMeshlets ? MESH_CACHE_FLAG_MESHLETS : 0);
+		if (readMeshCache(cachePath, sourceHash, sourceSize, importFlags, *this))
+		{
+			std::cout << "Loaded mesh cache " << cachePath << std::endl;
+			return;
+		}
+
+		parseObj(filepath);
+		if (optimizeForGpu)
+			optimize();
+		computeBounds();
+		if (generateLods)
+			buildLods();
+		if (generateMeshlets)
+			buildMeshlets();
+		if (writeMeshCache(cachePath, sourceHash, sourceSize, importFlags, *this))
+			std::cout << "Wrote mesh cache " << cachePath << std::endl;
+	}
+
+	void LveModel::Builder::computeBounds()
+	{
+		if (vertices.empty())
+		{
+			boundsMin = boundsMax = glm::vec3{0.f};
+			return;
+		}
+		boundsMin = boundsMax = vertices[0].position;
+		for (const auto &vertex : vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+	}
+
+	void LveModel::Builder::optimize()
+	{
+		VertexCacheStats before = analyzeVertexCache(indices, vertices.size());
+
+		std::vector<uint32_t> clusterStarts;
+		optimizeVertexCache(indices, vertices.size(), VERTEX_CACHE_SIZE, clusterStarts);
+		optimizeOverdraw(indices, vertices, clusterStarts, VERTEX_CACHE_SIZE);
+		optimizeVertexFetch(vertices, indices); //last, the two passes above decide the order vertices get used in
+
+		VertexCacheStats after = analyzeVertexCache(indices, vertices.size());
+		std::cout << "Mesh optimized : ACMR " << before.acmr << " -> " << after.acmr
+			<< ", ATVR " << before.atvr << " -> " << after.atvr
+			<< " (" << before.transforms << " -> " << after.transforms << " vertex shader runs)" << std::endl;
+	}
+
+	void LveModel::Builder::buildLods()
+	{
+		lods.clear();
+		if (indices.empty())
+			return;
+
+		//every level is simplified from the full mesh so errors do not pile up level after level
+		const std::vector<uint32_t> fullMesh = indices;
+		const float maxError = glm::length(boundsMax - boundsMin) * LOD_MAX_RELATIVE_ERROR;
+		lods.push_back({0, static_cast<uint32_t>(fullMesh.size()), 0.f});
+		for (uint32_t level = 1; level < MAX_LOD_COUNT; level++)
+		{
+			size_t targetIndexCount = (fullMesh.size() / 3 >> level) * 3;
+			if (targetIndexCount < LOD_MIN_TRIANGLES * 3)
+				break;
+
+			float error;
+			std::vector<uint32_t> lod = simplifyMesh(vertices, fullMesh, targetIndexCount, maxError, error);
+			if (lod.size() > lods.back().indexCount * 4 / 5) //stuck on borders or the error cap, not worth a level
+				break;
+			if (optimizeForGpu)
+			{
+				std::vector<uint32_t> clusterStarts;
+				optimizeVertexCache(lod, vertices.size(), VERTEX_CACHE_SIZE, clusterStarts);
+			}
+			//error is kept increasing with the level so selection can stop at the first level that is too coarse
+			lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod.size()), std::max(error, lods.back().error)});
+			indices.insert(indices.end(), lod.begin(), lod.end());
+		}
+	}
+
+	void LveModel::Builder::buildMeshlets()
+	{
+		meshlets.clear();
+		size_t lod0IndexCount = lods.empty() ? indices.size() : lods[0].indexCount;
+		if (lod0IndexCount / 3 < MESHLET_MIN_TRIANGLES)
+			return;
+		meshlets = clusterMeshlets(vertices, indices, lod0IndexCount);
+	}
+
+	void LveModel::Builder::parseObj(const std::string &filepath)
+	{
+		ObjData attrib; //stores textures coord, position, color, normal and the triangulated face corners
+		parseObjFile(filepath, attrib, parseThreads);
+		vertices.clear();
+		indices.clear();
+		lods.clear();
+		meshlets.clear();
+		indices.reserve(attrib.indices.size());
+
+		WeldTable<Vertex> unique_vertices{vertices, attrib.indices.size()}; //slots preallocated, every corner could be unique
+		for (const auto &mesh_index : attrib.indices)
+		{
+			Vertex vertex{};
+			if (mesh_index.vertex_index >= 0) //if value is negative then no index was provided
+			{
+				vertex.position = {
+					attrib.vertices[3 * mesh_index.vertex_index + 0],
+					attrib.vertices[3 * mesh_index.vertex_index + 1],
+					attrib.vertices[3 * mesh_index.vertex_index + 2]
+				};
+
+				vertex.color = {
+					attrib.colors[3 * mesh_index.vertex_index + 0],
+					attrib.colors[3 * mesh_index.vertex_index + 1],
+					attrib.colors[3 * mesh_index.vertex_index + 2]
+				};
+
+			}
+			if (mesh_index.normal_index >= 0) //if value is negative then no index was provided
+			{
+				vertex.normal = {
+					attrib.normals[3 * mesh_index.normal_index + 0],
+					attrib.normals[3 * mesh_index.normal_index + 1],
+					attrib.normals[3 * mesh_index.normal_index + 2]
+				};
+			}
+			if (mesh_index.texcoord_index >= 0) //if value is negative then no index was provided
+			{
+				vertex.uv = {
+					attrib.texcoords[2 * mesh_index.texcoord_index + 0],
+					attrib.texcoords[2 * mesh_index.texcoord_index + 1]
+				};
+			}
+			indices.push_back(unique_vertices.weld(vertex)); //appends the vertex if it is new and gives back its position
+		}
+	}
+}
@@ -0,0 +1,289 @@
+#include "obj_parser.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+namespace wind
+{
+	namespace
+	{
+		constexpr size_t MIN_CHUNK_SIZE = 64 * 1024; //below this handing a chunk to another thread costs more than parsing the bytes
+
+		//what one thread produces, negative obj indices can point into a previous chunk so they are
+		//stored relative to the chunk start and rebased during the merge
+		struct ObjChunk
+		{
+			std::vector<float>		vertices;
+			std::vector<float>		colors;
+			std::vector<float>		normals;
+			std::vector<float>		texcoords;
+			std::vector<ObjIndex>	indices;
+			std::vector<uint32_t>	relativeFixups; //corner * 3 + component (0 vertex, 1 normal, 2 texcoord)
+			std::string				error;
+		};
+
+		inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+		inline const char *skipSpaces(const char *p, const char *end)
+		{
+			while (p < end && isSpace(*p))
+				p++;
+			return p;
+		}
+
+		//false when there is no number left on the line
+		inline bool parseFloat(const char *&p, const char *end, float &value)
+		{
+			p = skipSpaces(p, end);
+			if (p < end && *p == '+') //from_chars does not take a leading +
+				p++;
+			double parsed;
+			auto result = std::from_chars(p, end, parsed);
+			if (result.ec != std::errc())
+				return false;
+			p = result.ptr;
+			value = static_cast<float>(parsed); //same double then float path as tinyobj
+			return true;
+		}
+
+		inline bool parseIndex(const char *&p, const char *end, int32_t &value)
+		{
+			if (p < end && *p == '+')
+				p++;
+			auto result = std::from_chars(p, end, value);
+			if (result.ec != std::errc())
+				return false;
+			p = result.ptr;
+			return true;
+		}
+
+		//obj indices are 1 based, negative ones count back from the last element read so far
+		inline bool resolveIndex(int32_t raw, size_t countSoFar, int32_t &resolved, bool &relative)
+		{
+			if (raw > 0)
+			{
+				resolved = raw - 1;
+				relative = false;
+				return true;
+			}
+			if (raw < 0)
+			{
+				resolved = static_cast<int32_t>(countSoFar) + raw; //local to the chunk for now
+				relative = true;
+				return true;
+			}
+			return false;
+		}
+
+		struct FaceCorner
+		{
+			ObjIndex	index;
+			bool		relative[3];
+		};
+
+		bool parseFace(const char *p, const char *end, ObjChunk &chunk, std::vector<FaceCorner> &polygon)
+		{
+			polygon.clear();
+			while (true)
+			{
+				p = skipSpaces(p, end);
+				if (p >= end)
+					break;
+
+				FaceCorner corner{{-1, -1, -1}, {false, false, false}};
+				int32_t raw;
+				if (!parseIndex(p, end, raw) || !resolveIndex(raw, chunk.vertices.size() / 3, corner.index.vertex_index, corner.relative[0]))
+					return false;
+				if (p < end && *p == '/')
+				{
+					p++;
+					if (p < end && *p != '/') //v/vt or v/vt/vn
+					{
+						if (!parseIndex(p, end, raw) || !resolveIndex(raw, chunk.texcoords.size() / 2, corner.index.texcoord_index, corner.relative[2]))
+							return false;
+					}
+					if (p < end && *p == '/') //v//vn or v/vt/vn
+					{
+						p++;
+						if (!parseIndex(p, end, raw) || !resolveIndex(raw, chunk.normals.size() / 3, corner.index.normal_index, corner.relative[1]))
+							return false;
+					}
+				}
+				if (p < end && !isSpace(*p))
+					return false;
+				polygon.push_back(corner);
+			}
+
+			//fan triangulation like tinyobj does for convex polygons, bundled models are all triangles anyway
+			for (size_t k = 1; k + 1 < polygon.size(); k++)
+			{
+				const size_t triangle[3] = {0, k, k + 1};
+				for (size_t corner : triangle)
+				{
+					uint32_t cornerIndex = static_cast<uint32_t>(chunk.indices.size());
+					for (uint32_t component = 0; component < 3; component++)
+					{
+						if (polygon[corner].relative[component])
+							chunk.relativeFixups.push_back(cornerIndex * 3 + component);
+					}
+					chunk.indices.push_back(polygon[corner].index);
+				}
+			}
+			return true;
+		}
+
+		void parseChunk(const char *begin, const char *end, ObjChunk &chunk)
+		{
+			//rough guess from the bundled models, saves most of the regrowth
+			size_t lineGuess = static_cast<size_t>(end - begin) / 32;
+			chunk.vertices.reserve(lineGuess);
+			chunk.indices.reserve(lineGuess);
+
+			std::vector<FaceCorner> polygon;
+			const char *line = begin;
+			while (line < end)
+			{
+				const char *lineEnd = static_cast<const char *>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+				if (lineEnd == nullptr)
+					lineEnd = end;
+
+				const char *p = skipSpaces(line, lineEnd);
+				size_t length = static_cast<size_t>(lineEnd - p);
+				if (length >= 2 && p[0] == 'v' && isSpace(p[1]))
+				{
+					p += 2;
+					float x = 0.f, y = 0.f, z = 0.f;
+					parseFloat(p, lineEnd, x);
+					parseFloat(p, lineEnd, y);
+					parseFloat(p, lineEnd, z);
+					float r, g, b;
+					if (!(parseFloat(p, lineEnd, r) && parseFloat(p, lineEnd, g) && parseFloat(p, lineEnd, b)))
+						r = g = b = 1.f;
+					chunk.vertices.insert(chunk.vertices.end(), {x, y, z});
+					chunk.colors.insert(chunk.colors.end(), {r, g, b});
+				}
+				else if (length >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+				{
+					p += 3;
+					float x = 0.f, y = 0.f, z = 0.f;
+					parseFloat(p, lineEnd, x);
+					parseFloat(p, lineEnd, y);
+					parseFloat(p, lineEnd, z);
+					chunk.normals.insert(chunk.normals.end(), {x, y, z});
+				}
+				else if (length >= 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2]))
+				{
+					p += 3;
+					float u = 0.f, v = 0.f;
+					parseFloat(p, lineEnd, u);
+					parseFloat(p, lineEnd, v);
+					chunk.texcoords.insert(chunk.texcoords.end(), {u, v});
+				}
+				else if (length >= 2 && p[0] == 'f' && isSpace(p[1]))
+				{
+					if (!parseFace(p + 2, lineEnd, chunk, polygon))
+					{
+						chunk.error = "invalid face : " + std::string(line, lineEnd);
+						return;
+					}
+				}
+				//everything else (comments, o, g, s, usemtl, mtllib) does not end up in our vertex buffer
+				line = lineEnd + 1;
+			}
+		}
+
+		inline bool inRange(int32_t index, size_t count) { return index >= 0 && static_cast<size_t>(index) < count; }
+	}
+
+	void parseObjFile(const std::string &filepath, ObjData &out, ThreadPool *threads)
+	{
+		MappedFile file;
+		if (!file.open(filepath))
+			throw std::runtime_error("failed to open file " + filepath);
+
+		const unsigned threadCount = threads != nullptr ? threads->getThreadCount() : 1;
+		size_t chunkCount = std::clamp<size_t>(file.size() / MIN_CHUNK_SIZE, 1, threadCount);
+
+		//cut points are moved forward to the next line start so no record is split between two threads
+		const char *data = file.data();
+		const char *end = data + file.size();
+		std::vector<const char *> cuts(chunkCount + 1);
+		cuts[0] = data;
+		cuts[chunkCount] = end;
+		for (size_t i = 1; i < chunkCount; i++)
+		{
+			const char *cut = std::max(cuts[i - 1], data + file.size() * i / chunkCount);
+			const char *newline = static_cast<const char *>(std::memchr(cut, '\n', static_cast<size_t>(end - cut)));
+			cuts[i] = newline ? newline + 1 : end;
+		}
+
+		std::vector<ObjChunk> chunks(chunkCount);
+		if (chunkCount == 1)
+			parseChunk(cuts[0], cuts[1], chunks[0]);
+		else
+			threads->run(chunkCount, [&](size_t i) { parseChunk(cuts[i], cuts[i + 1], chunks[i]); });
+
+		for (const auto &chunk : chunks)
+		{
+			if (!chunk.error.empty())
+				throw std::runtime_error(filepath + " : " + chunk.error);
+		}
+
+		size_t vertexFloats = 0, normalFloats = 0, texcoordFloats = 0, cornerCount = 0;
+		for (const auto &chunk : chunks)
+		{
+			vertexFloats += chunk.vertices.size();
+			normalFloats += chunk.normals.size();
+			texcoordFloats += chunk.texcoords.size();
+			cornerCount += chunk.indices.size();
+		}
+		out.vertices.clear();
+		out.colors.clear();
+		out.normals.clear();
+		out.texcoords.clear();
+		out.indices.clear();
+		out.vertices.reserve(vertexFloats);
+		out.colors.reserve(vertexFloats);
+		out.normals.reserve(normalFloats);
+		out.texcoords.reserve(texcoordFloats);
+		out.indices.reserve(cornerCount);
+
+		//merge in file order, this is what keeps the result identical to a single threaded parse
+		for (auto &chunk : chunks)
+		{
+			const int32_t bases[3] = {
+				static_cast<int32_t>(out.vertices.size() / 3),
+				static_cast<int32_t>(out.normals.size() / 3),
+				static_cast<int32_t>(out.texcoords.size() / 2)
+			};
+			for (uint32_t fixup : chunk.relativeFixups)
+			{
+				ObjIndex &corner = chunk.indices[fixup / 3];
+				int32_t *component[3] = {&corner.vertex_index, &corner.normal_index, &corner.texcoord_index};
+				*component[fixup % 3] += bases[fixup % 3];
+				if (*component[fixup % 3] < 0)
+					throw std::runtime_error(filepath + " : relative index points before the first element");
+			}
+			out.vertices.insert(out.vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+			out.colors.insert(out.colors.end(), chunk.colors.begin(), chunk.colors.end());
+			out.normals.insert(out.normals.end(), chunk.normals.begin(), chunk.normals.end());
+			out.texcoords.insert(out.texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+			out.indices.insert(out.indices.end(), chunk.indices.begin(), chunk.indices.end());
+		}
+
+		const size_t vertexCount = out.vertices.size() / 3;
+		const size_t normalCount = out.normals.size() / 3;
+		const size_t texcoordCount = out.texcoords.size() / 2;
+		for (const auto &corner : out.indices)
+		{
+			if (!inRange(corner.vertex_index, vertexCount)
+				|| (corner.normal_index != -1 && !inRange(corner.normal_index, normalCount))
+				|| (corner.texcoord_index != -1 && !inRange(corner.texcoord_index, texcoordCount)))
+				throw std::runtime_error(filepath + " : face index out of range");
+		}
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace wind
+{
+	struct ObjIndex
+	{
+		int32_t vertex_index; //0 based, -1 when the face corner does not reference that attribute
+		int32_t normal_index;
+		int32_t texcoord_index;
+	};
+
+	//same split as tinyobj::attrib_t so the welding code did not have to change much
+	struct ObjData
+	{
+		std::vector<float>		vertices; //xyz
+		std::vector<float>		colors; //rgb, one per vertex, 1.0 when the file has no vertex colors (tinyobj default)
+		std::vector<float>		normals; //xyz
+		std::vector<float>		texcoords; //uv
+		std::vector<ObjIndex>	indices; //triangulated faces, 3 corners per triangle, in file order
+	};
+
+	class ThreadPool;
+
+	//maps the file, cuts it on line boundaries and parses the chunks on the pool threads (calling thread only without one)
+	//chunks are merged back in file order so the output does not depend on the thread count
+	void parseObjFile(const std::string &filepath, ObjData &out, ThreadPool *threads = nullptr);
+}
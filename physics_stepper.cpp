@@ -0,0 +1,108 @@
+#include "physics_stepper.hpp"
+
+#include <cmath>
+
+namespace wind
+{
+	uint32_t PhysicsStepper::advance(Scene &scene, float frameTime)
+	{
+		accumulator += frameTime;
+		lastSteps = 0;
+		if (accumulator >= tick)
+		{
+			sync(scene);
+			while (accumulator >= tick && lastSteps < maxSteps)
+			{
+				integrateBodies(store, tick, floorY);
+				collisions.step(store, tick);
+				accumulator -= tick;
+				lastSteps++;
+			}
+		}
+		//a hitch longer than maxSteps ticks would ask for even more steps next frame, the sim slows down instead
+		if (accumulator >= tick)
+		{
+			const float skipped = std::floor(accumulator / tick) * tick;
+			droppedTime += skipped;
+			accumulator -= skipped;
+		}
+		totalSteps += lastSteps;
+		interpolate(scene);
+		return lastSteps;
+	}
+
+	void PhysicsStepper::step(Scene &scene)
+	{
+		sync(scene);
+		integrateBodies(store, tick, floorY);
+		collisions.step(store, tick);
+	}
+
+	void PhysicsStepper::sync(Scene &scene)
+	{
+		auto &bodies = scene.rigidBodies;
+		if (bodies.getChangeCount() == bodyChanges && scene.colliders.getChangeCount() == colliderChanges)
+			return;
+		bodyChanges = bodies.getChangeCount();
+		colliderChanges = scene.colliders.getChangeCount();
+
+		syncCount++;
+		for (size_t i = 0; i < bodies.size(); i++)
+		{
+			auto &body = bodies[i];
+			const Entity entity = bodies.entity(i);
+			if (body.body < store.size() && store.entities[body.body] == entity && seen[body.body] != syncCount)
+			{
+				seen[body.body] = syncCount;
+				continue;
+			}
+			//new, or its component was replaced : starts over from the transform
+			body.body = static_cast<uint32_t>(store.add(entity, scene.transforms.get(entity)->translation));
+			seen.push_back(syncCount);
+			store.velocityX[body.body] = body.speed.x;
+			store.velocityY[body.body] = body.speed.y;
+			store.velocityZ[body.body] = body.speed.z;
+			store.accelerationX[body.body] = body.acceleration.x;
+			store.accelerationY[body.body] = body.acceleration.y;
+			store.accelerationZ[body.body] = body.acceleration.z;
+			store.inverseMass[body.body] = body.mass == EARTH ? 0.f : 1.f / body.mass;
+			store.flags[body.body] = body.mass == EARTH ? BODY_STATIC : 0;
+		}
+		//from the back, so the body moving into a hole was found above and its component can be pointed at it
+		for (size_t i = store.size(); i-- > 0;)
+		{
+			if (seen[i] == syncCount)
+				continue;
+			store.swapRemove(i);
+			seen[i] = seen.back();
+			seen.pop_back();
+			if (i < store.size())
+				bodies.get(store.entities[i])->body = static_cast<uint32_t>(i);
+		}
+
+		for (size_t i = 0; i < store.size(); i++)
+		{
+			if (scene.colliders.has(store.entities[i]))
+				store.flags[i] |= BODY_COLLIDES;
+			else
+				store.flags[i] &= ~BODY_COLLIDES;
+		}
+		collisions.gather(scene, store);
+	}
+
+	void PhysicsStepper::interpolate(Scene &scene) const
+	{
+		const float alpha = getAlpha();
+		for (size_t i = 0; i < store.size(); i++)
+		{
+			//removed since the last sync, the handle no longer finds anything
+			TransformComponent *transform = scene.transforms.get(store.entities[i]);
+			if (transform == nullptr)
+				continue;
+			const glm::vec3 position{store.positionX[i], store.positionY[i], store.positionZ[i]};
+			const glm::vec3 previous{store.previousX[i], store.previousY[i], store.previousZ[i]};
+			//bodies at rest get exactly their position so their cached matrices stay clean
+			transform->translation = previous == position ? position : glm::mix(previous, position, alpha);
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "collision.hpp"
+#include "scene.hpp"
+#include "rigid_body_store.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace wind
+{
+	//runs the physics at a fixed tick whatever the frame rate : frame time goes into an accumulator
+	//and whole ticks are taken out of it, so the results don't depend on how the frames were cut
+	//ticks run on a RigidBodyStore with the simd kernel of the cpu, the stepper keeps it for the whole run and only
+	//goes back to the scene when bodies or colliders were added or removed (ComponentPool::getChangeCount)
+	//each integration is followed by the collisions of the bodies that have a ColliderComponent
+	//bodies keep their position before and after the last tick, the transforms get a blend of the two
+	//with what is left in the accumulator so the motion stays smooth between ticks
+	class PhysicsStepper
+	{
+		public:
+			static constexpr float		DEFAULT_TICK = 1.f / 120.f;
+			static constexpr uint32_t	DEFAULT_MAX_STEPS = 8; //past that a frame is too slow to catch up, the time is dropped
+
+			PhysicsStepper(float tick = DEFAULT_TICK, uint32_t maxSteps = DEFAULT_MAX_STEPS) : tick{tick}, maxSteps{maxSteps} {}
+
+			//steps as many ticks as the accumulator holds (at most maxSteps) then interpolates, returns the steps taken
+			uint32_t advance(Scene &scene, float frameTime);
+			//one tick of every body, collisions included
+			void step(Scene &scene);
+			//transform translation = previous and current position blended by getAlpha()
+			void interpolate(Scene &scene) const;
+
+			//how far between the last two ticks the frame is, in [0, 1)
+			float getAlpha() const { return accumulator / tick; }
+			float getTick() const { return tick; }
+			uint32_t getLastSteps() const { return lastSteps; }
+			uint64_t getTotalSteps() const { return totalSteps; }
+			float getDroppedTime() const { return droppedTime; } //seconds lost to the step cap since the start
+			const CollisionWorld &getCollisions() const { return collisions; }
+			//simulated state, RigidBodyComponent::body is the index of a body in it
+			const RigidBodyStore &getBodies() const { return store; }
+
+			//height of the EARTH body, y points down, bodies without a collider (model still streaming) stop there
+			float floorY = 0.f;
+
+		private:
+			float		tick;
+			uint32_t	maxSteps;
+			float		accumulator = 0.f;
+			uint32_t	lastSteps = 0;
+			uint64_t	totalSteps = 0;
+			float		droppedTime = 0.f;
+			RigidBodyStore	store;
+			CollisionWorld	collisions;
+			uint64_t		bodyChanges = UINT64_MAX; //change counts of the pools as of the last sync
+			uint64_t		colliderChanges = UINT64_MAX;
+			uint32_t		syncCount = 0;
+			std::vector<uint32_t> seen; //per store body, syncCount when its component was last found
+
+			//adds the new RigidBodyComponents to the store and drops the ones that went away, when the pools changed
+			void sync(Scene &scene);
+	};
+}
@@ -44,8 +44,8 @@ namespace wind
 			void bind(VkCommandBuffer commandBuffer); 
 			static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 			static void enableAlphaBlending(PipelineConfigInfo& configInfo);
-		private:
 			static std::vector<char> readFile(const std::string& filePath);
+		private:
 
 			void createGraphicsPipeline(
 				const std::string & vertFilePath,
@@ -60,4 +60,21 @@ namespace wind
 			VkShaderModule fragShaderModule;
 		
 	};
+
+	//a single compute shader, the layout is owned by whoever creates it like for Pipeline
+	class ComputePipeline
+	{
+		public:
+			ComputePipeline(EngineDevice& device, const std::string& compFilePath, VkPipelineLayout pipelineLayout);
+			~ComputePipeline();
+
+			ComputePipeline(const ComputePipeline&) = delete;
+			ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+			void bind(VkCommandBuffer commandBuffer);
+		private:
+			EngineDevice& device;
+			VkPipeline computePipeline;
+			VkShaderModule computeShaderModule;
+	};
 }
\ No newline at end of file
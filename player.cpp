@@ -3,7 +3,7 @@
 
 namespace wind
 {
-	Player::Player(LveGameObject &entity) : physicalEntity(entity)
+	Player::Player(Entity entity) : physicalEntity(entity)
 	{
 
 	}
@@ -2,7 +2,7 @@
 
 #include <vector>
 #include <glm/glm.hpp>
-#include "game_object.hpp"
+#include "scene.hpp"
 
 typedef struct s_projectiles
 {
@@ -15,11 +15,11 @@ namespace wind
 	class Player
 	{
 		public:
-			Player(LveGameObject &entity);
+			Player(Entity entity);
 			~Player();
 
 			
-			LveGameObject physicalEntity;
+			Entity physicalEntity; //transform and PlayerComponent live in the scene
 		private:
 			glm::vec3 position;
 			std::vector<t_projectiles> projectiles;
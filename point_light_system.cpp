@@ -1,7 +1,6 @@
 #include "point_light_system.hpp"
 #include <array>
 #include <iostream>
-#include <map>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -75,66 +74,61 @@ namespace wind
 			{0.f, -1.f, 0.f});
 		
 		int lightIndex = 0;
-		for (auto &kv: frameInfo.gameObjects)
+		auto &pointLights = frameInfo.scene.pointLights;
+		for (size_t i = 0; i < pointLights.size() && lightIndex < MAX_LIGHTS; i++)
 		{
-			auto& obj = kv.second;
-			if (obj.point_light_intensity == -1)
-				continue;
+			auto &light = pointLights[i];
+			auto &transform = *frameInfo.scene.transforms.get(pointLights.entity(i));
 
-			obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.f));
+			transform.translation = glm::vec3(rotateLight * glm::vec4(transform.translation, 1.f));
 			
-			ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.f);
-			ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.point_light_intensity);
+			ubo.pointLights[lightIndex].position = glm::vec4(transform.translation, 1.f);
+			ubo.pointLights[lightIndex].color = glm::vec4(light.color, light.intensity);
 
 			lightIndex++;
 		}
 		ubo.lightCount = lightIndex;
 	}
 
-	void PointLightSystem::render(s_frame_info &frameInfo)
+	void PointLightSystem::submit(s_frame_info &frameInfo, RenderQueue &queue)
 	{
-		std::map<float, LveGameObject::id_t> sorted;
-
-		for (auto &kv: frameInfo.gameObjects)
+		//blended, so they go in the transparent pass and the key orders them back to front
+		lights.clear();
+		auto &pointLights = frameInfo.scene.pointLights;
+		for (size_t i = 0; i < pointLights.size(); i++)
 		{
-			auto &obj = kv.second;
-			if (obj.point_light_intensity == -1)
-				continue;
+			const auto &transform = *frameInfo.scene.transforms.get(pointLights.entity(i));
 			
-			auto offset = frameInfo.camera.getPosition() - obj.transform.translation;
+			auto offset = frameInfo.camera.getPosition() - transform.translation;
 			float disSquared = glm::dot(offset, offset);
-			sorted[disSquared] = obj.getId();
+			queue.submit(RenderQueue::transparentKey(0, 0, 0, disSquared), *this, static_cast<uint32_t>(lights.size()));
+			lights.push_back({&pointLights[i], &transform});
 		}
-		pipeline->bind(frameInfo.commandBuffer);
-
-		vkCmdBindDescriptorSets(
-			frameInfo.commandBuffer,
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			pipelineLayout,
-			0, 1,
-			&frameInfo.globalDescriptorSet,
-			0, nullptr
-		);
-
-		for (auto it = sorted.rbegin(); it != sorted.rend(); ++it)
+	}
+
+	void PointLightSystem::emit(s_frame_info &frameInfo, const DrawPacket *packets, size_t count, RenderState &state)
+	{
+		state.bindPipeline(*pipeline);
+		state.bindDescriptorSet(pipelineLayout, 0, frameInfo.globalDescriptorSet);
+
+		for (size_t i = 0; i < count; i++)
 		{
-			auto &obj = frameInfo.gameObjects.at(it->second);
+			const LightDraw &draw = lights[packets[i].item];
 			
 			PointLightPushConstants push{};
-			push.position = glm::vec4(obj.transform.translation, 1.f);
-			push.color = glm::vec4(obj.color, obj.point_light_intensity);
-			push.radius = obj.transform.scale;
+			push.position = glm::vec4(draw.transform->translation, 1.f);
+			push.color = glm::vec4(draw.light->color, draw.light->intensity);
+			push.radius = draw.transform->scale;
 
 			vkCmdPushConstants(
-				frameInfo.commandBuffer,
+				state.getCommandBuffer(),
 				pipelineLayout,
 				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
 				0,
 				sizeof(PointLightPushConstants),
 				&push
 			);
-			vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
+			vkCmdDraw(state.getCommandBuffer(), 6, 1, 0, 0);
 		}
-
 	}
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "engine.hpp"
 #include "camera.hpp"
 #include "frame_info.hpp"
+#include "render_queue.hpp"
 
 #include <memory>
 #include <vector>
@@ -12,7 +13,7 @@
 
 namespace wind
 {
-	class PointLightSystem
+	class PointLightSystem : public QueueEmitter
 	{
 		public:
 			PointLightSystem(EngineDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
@@ -23,7 +24,8 @@ namespace wind
 
 
 			void update(s_frame_info &frameinfo, GlobalUBO &ubo);
-			void render(s_frame_info &frameinfo);
+			void submit(s_frame_info &frameinfo, RenderQueue &queue);
+			void emit(s_frame_info &frameinfo, const DrawPacket *packets, size_t count, RenderState &state) override;
 
 
 		private:
@@ -34,5 +36,11 @@ namespace wind
 
 			std::unique_ptr<Pipeline> pipeline; //probly stack allocatable
 			VkPipelineLayout pipelineLayout;
+			struct LightDraw
+			{
+				const PointLightComponent	*light;
+				const TransformComponent	*transform;
+			};
+			std::vector<LightDraw> lights; //this frame submissions, packets index them
 	};
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include "range_allocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace wind
+{
+	namespace
+	{
+		uint32_t highestBit(uint64_t value) { return 63 - static_cast<uint32_t>(__builtin_clzll(value)); }
+		uint32_t lowestBit(uint64_t value) { return static_cast<uint32_t>(__builtin_ctzll(value)); }
+
+		//bin of a free range, rounded down : everything in it is at least as large as the bin start
+		void binOf(uint64_t size, uint32_t slBits, uint32_t &fl, uint32_t &sl)
+		{
+			const uint64_t slCount = 1ull << slBits;
+			if (size < slCount)
+			{
+				fl = 0;
+				sl = static_cast<uint32_t>(size);
+				return;
+			}
+			uint32_t msb = highestBit(size);
+			fl = msb - slBits + 1;
+			sl = static_cast<uint32_t>((size >> (msb - slBits)) ^ slCount);
+		}
+	}
+
+	RangeAllocator::RangeAllocator(uint64_t capacity) : capacity{capacity}
+	{
+		for (auto &firstLevel : bins)
+		{
+			for (uint32_t &bin : firstLevel)
+				bin = NONE;
+		}
+		if (capacity > 0)
+		{
+			last = newRange(0, capacity);
+			insertFree(last);
+		}
+	}
+
+	uint32_t RangeAllocator::newRange(uint64_t offset, uint64_t size)
+	{
+		uint32_t range;
+		if (!unusedRanges.empty())
+		{
+			range = unusedRanges.back();
+			unusedRanges.pop_back();
+		}
+		else
+		{
+			range = static_cast<uint32_t>(ranges.size());
+			ranges.emplace_back();
+		}
+		ranges[range] = Range{};
+		ranges[range].offset = offset;
+		ranges[range].size = size;
+		return range;
+	}
+
+	void RangeAllocator::insertFree(uint32_t range)
+	{
+		uint32_t fl, sl;
+		binOf(ranges[range].size, SL_BITS, fl, sl);
+		Range &r = ranges[range];
+		r.free = true;
+		r.prevFree = NONE;
+		r.nextFree = bins[fl][sl];
+		if (r.nextFree != NONE)
+			ranges[r.nextFree].prevFree = range;
+		bins[fl][sl] = range;
+		firstLevelMap |= 1ull << fl;
+		secondLevelMap[fl] |= 1u << sl;
+	}
+
+	void RangeAllocator::removeFree(uint32_t range)
+	{
+		uint32_t fl, sl;
+		binOf(ranges[range].size, SL_BITS, fl, sl);
+		Range &r = ranges[range];
+		if (r.prevFree != NONE)
+			ranges[r.prevFree].nextFree = r.nextFree;
+		else
+			bins[fl][sl] = r.nextFree;
+		if (r.nextFree != NONE)
+			ranges[r.nextFree].prevFree = r.prevFree;
+		r.free = false;
+		r.prevFree = r.nextFree = NONE;
+
+		if (bins[fl][sl] == NONE)
+		{
+			secondLevelMap[fl] &= ~(1u << sl);
+			if (secondLevelMap[fl] == 0)
+				firstLevelMap &= ~(1ull << fl);
+		}
+	}
+
+	uint32_t RangeAllocator::split(uint32_t range, uint64_t size)
+	{
+		uint32_t rest = newRange(ranges[range].offset + size, ranges[range].size - size);
+		Range &r = ranges[range];
+		r.size = size;
+		ranges[rest].prevPhysical = range;
+		ranges[rest].nextPhysical = r.nextPhysical;
+		if (r.nextPhysical != NONE)
+			ranges[r.nextPhysical].prevPhysical = rest;
+		else
+			last = rest;
+		r.nextPhysical = rest;
+		return rest;
+	}
+
+	void RangeAllocator::absorbNext(uint32_t range)
+	{
+		uint32_t next = ranges[range].nextPhysical;
+		ranges[range].size += ranges[next].size;
+		ranges[range].nextPhysical = ranges[next].nextPhysical;
+		if (ranges[next].nextPhysical != NONE)
+			ranges[ranges[next].nextPhysical].prevPhysical = range;
+		else
+			last = range;
+		unusedRanges.push_back(next);
+	}
+
+	bool RangeAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t &offset)
+	{
+		if (size == 0)
+			size = 1;
+		if (alignment == 0)
+			alignment = 1;
+		//worst case padding is alignment - 1, asking for it up front means the first range found always fits
+		const uint64_t request = size + alignment - 1;
+		if (request > capacity - used)
+			return false;
+
+		//round the request up to the next bin so any range in the found bin is big enough
+		uint32_t fl, sl;
+		if (request < SL_COUNT)
+			binOf(request, SL_BITS, fl, sl);
+		else
+			binOf(request + (1ull << (highestBit(request) - SL_BITS)) - 1, SL_BITS, fl, sl);
+		if (fl >= FL_COUNT)
+			return false;
+
+		uint32_t slMap = sl < SL_COUNT ? secondLevelMap[fl] & (~0u << sl) : 0;
+		if (slMap == 0)
+		{
+			uint64_t flMap = fl + 1 < 64 ? firstLevelMap & (~0ull << (fl + 1)) : 0;
+			if (flMap == 0)
+				return false;
+			fl = lowestBit(flMap);
+			slMap = secondLevelMap[fl];
+		}
+		sl = lowestBit(slMap);
+		uint32_t range = bins[fl][sl];
+		removeFree(range);
+
+		uint64_t aligned = (ranges[range].offset + alignment - 1) / alignment * alignment;
+		uint64_t padding = aligned - ranges[range].offset;
+		if (padding > 0) //the front goes back to the free lists, its previous neighbour is used so nothing to merge
+		{
+			uint32_t front = range;
+			range = split(front, padding);
+			insertFree(front);
+		}
+		if (ranges[range].size > size)
+			insertFree(split(range, size));
+
+		used += size;
+		allocated[aligned] = range;
+		offset = aligned;
+		return true;
+	}
+
+	void RangeAllocator::free(uint64_t offset)
+	{
+		auto it = allocated.find(offset);
+		if (it == allocated.end())
+			throw std::runtime_error("freeing a range that was not allocated");
+		uint32_t range = it->second;
+		allocated.erase(it);
+		used -= ranges[range].size;
+
+		uint32_t next = ranges[range].nextPhysical;
+		if (next != NONE && ranges[next].free)
+		{
+			removeFree(next);
+			absorbNext(range);
+		}
+		uint32_t prev = ranges[range].prevPhysical;
+		if (prev != NONE && ranges[prev].free)
+		{
+			removeFree(prev);
+			absorbNext(prev);
+			range = prev;
+		}
+		insertFree(range);
+	}
+
+	uint64_t RangeAllocator::getLargestFree() const
+	{
+		if (firstLevelMap == 0)
+			return 0;
+		//the largest range sits in the highest non empty bin, ranges inside one bin differ by less than the bin width
+		uint32_t fl = highestBit(firstLevelMap);
+		uint32_t sl = highestBit(secondLevelMap[fl]);
+		uint64_t largest = 0;
+		for (uint32_t range = bins[fl][sl]; range != NONE; range = ranges[range].nextFree)
+			largest = std::max(largest, ranges[range].size);
+		return largest;
+	}
+
+	void RangeAllocator::grow(uint64_t newCapacity)
+	{
+		if (newCapacity < capacity)
+			throw std::runtime_error("range allocator cannot shrink");
+		if (newCapacity == capacity)
+			return;
+		uint32_t tail = newRange(capacity, newCapacity - capacity);
+		capacity = newCapacity;
+		if (last != NONE)
+		{
+			ranges[tail].prevPhysical = last;
+			ranges[last].nextPhysical = tail;
+			if (ranges[last].free)
+			{
+				removeFree(last);
+				absorbNext(last);
+				tail = last;
+			}
+		}
+		last = tail;
+		insertFree(tail);
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace wind
+{
+	//two level segregated fit (TLSF) placement over an abstract [0, capacity) range
+	//it only hands out offsets, whoever owns the range (a VkDeviceMemory block, a big buffer...) does the rest
+	//free ranges sit in bins by size, the first level is the highest set bit, the second level splits
+	//that power of two in SL_COUNT slices, so both allocate and free are O(1) bit scans
+	//neighbouring free ranges are merged on free
+	class RangeAllocator
+	{
+		public:
+			explicit RangeAllocator(uint64_t capacity);
+
+			//alignment does not have to be a power of two, returns false when no free range is large enough
+			bool allocate(uint64_t size, uint64_t alignment, uint64_t &offset);
+			void free(uint64_t offset); //offset must come from allocate
+			//adds [capacity, newCapacity) at the end of the range, newCapacity must not be smaller
+			void grow(uint64_t newCapacity);
+
+			uint64_t getCapacity() const { return capacity; }
+			uint64_t getUsed() const { return used; } //alignment padding counts as free
+			uint64_t getLargestFree() const; //largest single allocation that could still succeed, before alignment
+			size_t getAllocationCount() const { return allocated.size(); }
+			bool isEmpty() const { return allocated.empty(); }
+
+		private:
+			static constexpr uint32_t SL_BITS = 4;
+			static constexpr uint32_t SL_COUNT = 1u << SL_BITS;
+			static constexpr uint32_t FL_COUNT = 64 - SL_BITS + 1;
+			static constexpr uint32_t NONE = UINT32_MAX;
+
+			struct Range
+			{
+				uint64_t	offset = 0;
+				uint64_t	size = 0;
+				uint32_t	prevPhysical = NONE; //neighbours in address order
+				uint32_t	nextPhysical = NONE;
+				uint32_t	prevFree = NONE; //neighbours in the same bin
+				uint32_t	nextFree = NONE;
+				bool		free = false;
+			};
+
+			uint64_t		capacity;
+			uint64_t		used = 0;
+			uint32_t		last = NONE; //range ending at capacity
+
+			std::vector<Range>		ranges;
+			std::vector<uint32_t>	unusedRanges; //slots of ranges that were merged away
+			std::unordered_map<uint64_t, uint32_t> allocated; //offset to range
+
+			uint64_t				firstLevelMap = 0;
+			uint32_t				secondLevelMap[FL_COUNT]{};
+			uint32_t				bins[FL_COUNT][SL_COUNT];
+
+			uint32_t newRange(uint64_t offset, uint64_t size);
+			void insertFree(uint32_t range);
+			void removeFree(uint32_t range);
+			//cuts [offset + size, end) off range and returns it as a new range
+			uint32_t split(uint32_t range, uint64_t size);
+			//range swallows its next physical neighbour
+			void absorbNext(uint32_t range);
+	};
+}
@@ -0,0 +1,151 @@
+#include "render_queue.hpp"
+
+#include <cstring>
+
+namespace wind
+{
+	void RenderState::begin(VkCommandBuffer commandBuffer)
+	{
+		*this = RenderState{};
+		this->commandBuffer = commandBuffer;
+	}
+
+	void RenderState::bindPipeline(Pipeline &pipeline)
+	{
+		if (this->pipeline == &pipeline)
+		{
+			stats.pipelineSkipped++;
+			return;
+		}
+		pipeline.bind(commandBuffer);
+		this->pipeline = &pipeline;
+		stats.pipelineBinds++;
+	}
+
+	void RenderState::bindDescriptorSet(VkPipelineLayout layout, uint32_t set, VkDescriptorSet descriptorSet)
+	{
+		if (descriptorLayouts[set] == layout && descriptorSets[set] == descriptorSet)
+		{
+			stats.descriptorSkipped++;
+			return;
+		}
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, set, 1, &descriptorSet, 0, nullptr);
+		descriptorLayouts[set] = layout;
+		descriptorSets[set] = descriptorSet;
+		stats.descriptorBinds++;
+	}
+
+	void RenderState::bindVertexBuffer(uint32_t binding, VkBuffer buffer)
+	{
+		if (vertexBuffers[binding] == buffer)
+		{
+			stats.bufferSkipped++;
+			return;
+		}
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, binding, 1, &buffer, &offset);
+		vertexBuffers[binding] = buffer;
+		stats.bufferBinds++;
+	}
+
+	void RenderState::bindIndexBuffer(VkBuffer buffer, VkIndexType indexType)
+	{
+		if (indexBuffer == buffer && this->indexType == indexType)
+		{
+			stats.bufferSkipped++;
+			return;
+		}
+		vkCmdBindIndexBuffer(commandBuffer, buffer, 0, indexType);
+		indexBuffer = buffer;
+		this->indexType = indexType;
+		stats.bufferBinds++;
+	}
+
+	namespace
+	{
+		//positive floats compare like their bit patterns, the top bits after the sign keep the order
+		uint64_t depthBits(float depth)
+		{
+			if (!(depth > 0.f)) //negative, zero and nan all go first
+				return 0;
+			uint32_t bits;
+			std::memcpy(&bits, &depth, sizeof(bits));
+			return bits >> (31 - RenderQueue::DEPTH_BITS);
+		}
+
+		uint64_t field(uint32_t value, uint32_t bits)
+		{
+			return static_cast<uint64_t>(value) & ((uint64_t(1) << bits) - 1);
+		}
+	}
+
+	uint64_t RenderQueue::opaqueKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+	{
+		return (uint64_t(PASS_OPAQUE) << 62)
+			| (field(pipeline, PIPELINE_BITS) << (MATERIAL_BITS + MESH_BITS + DEPTH_BITS))
+			| (field(material, MATERIAL_BITS) << (MESH_BITS + DEPTH_BITS))
+			| (field(mesh, MESH_BITS) << DEPTH_BITS)
+			| depthBits(depth);
+	}
+
+	uint64_t RenderQueue::transparentKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+	{
+		const uint64_t farFirst = ((uint64_t(1) << DEPTH_BITS) - 1) - depthBits(depth);
+		return (uint64_t(PASS_TRANSPARENT) << 62)
+			| (farFirst << (PIPELINE_BITS + MATERIAL_BITS + MESH_BITS))
+			| (field(pipeline, PIPELINE_BITS) << (MATERIAL_BITS + MESH_BITS))
+			| (field(material, MATERIAL_BITS) << MESH_BITS)
+			| field(mesh, MESH_BITS);
+	}
+
+	void RenderQueue::sort()
+	{
+		const size_t count = packets.size();
+		if (count < 2)
+			return;
+		scratch.resize(count);
+
+		//all eight histograms in one read of the keys
+		uint32_t histograms[8][256]{};
+		for (const DrawPacket &packet : packets)
+		{
+			for (int digit = 0; digit < 8; digit++)
+				histograms[digit][(packet.key >> (digit * 8)) & 0xff]++;
+		}
+
+		DrawPacket *source = packets.data();
+		DrawPacket *destination = scratch.data();
+		for (int digit = 0; digit < 8; digit++)
+		{
+			uint32_t *histogram = histograms[digit];
+			if (histogram[(source[0].key >> (digit * 8)) & 0xff] == count) //every key has this byte
+				continue;
+			uint32_t offset = 0;
+			for (int bucket = 0; bucket < 256; bucket++)
+			{
+				uint32_t bucketCount = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+			for (size_t i = 0; i < count; i++)
+				destination[histogram[(source[i].key >> (digit * 8)) & 0xff]++] = source[i];
+			std::swap(source, destination);
+		}
+		if (source != packets.data())
+			packets.swap(scratch);
+	}
+
+	void RenderQueue::execute(s_frame_info &frameInfo, RenderState &state)
+	{
+		size_t first = 0;
+		while (first < packets.size())
+		{
+			QueueEmitter *emitter = packets[first].emitter;
+			size_t end = first + 1;
+			while (end < packets.size() && packets[end].emitter == emitter)
+				end++;
+			emitter->emit(frameInfo, packets.data() + first, end - first, state);
+			first = end;
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "pipeline.hpp"
+#include "frame_info.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace wind
+{
+	//binds that went to the command buffer and the ones that were skipped because the state already matched
+	struct StateChangeStats
+	{
+		uint32_t	pipelineBinds = 0;
+		uint32_t	pipelineSkipped = 0;
+		uint32_t	descriptorBinds = 0;
+		uint32_t	descriptorSkipped = 0;
+		uint32_t	bufferBinds = 0; //vertex and index buffers
+		uint32_t	bufferSkipped = 0;
+
+		uint32_t redundant() const { return pipelineSkipped + descriptorSkipped + bufferSkipped; }
+	};
+
+	//what is currently bound in the command buffer, every bind goes through here and is dropped when it changes nothing
+	class RenderState
+	{
+		public:
+			static constexpr uint32_t MAX_VERTEX_BINDINGS = 2;
+			static constexpr uint32_t MAX_DESCRIPTOR_SETS = 2;
+
+			//forgets everything, the command buffer starts with nothing bound
+			void begin(VkCommandBuffer commandBuffer);
+
+			VkCommandBuffer getCommandBuffer() const { return commandBuffer; }
+			void bindPipeline(Pipeline &pipeline);
+			void bindDescriptorSet(VkPipelineLayout layout, uint32_t set, VkDescriptorSet descriptorSet);
+			void bindVertexBuffer(uint32_t binding, VkBuffer buffer);
+			void bindIndexBuffer(VkBuffer buffer, VkIndexType indexType);
+
+			const StateChangeStats &getStats() const { return stats; }
+
+		private:
+			VkCommandBuffer		commandBuffer = VK_NULL_HANDLE;
+			Pipeline			*pipeline = nullptr;
+			//sets bound with another layout may be disturbed (push constant ranges differ), so the layout is part of the state
+			VkPipelineLayout	descriptorLayouts[MAX_DESCRIPTOR_SETS]{};
+			VkDescriptorSet		descriptorSets[MAX_DESCRIPTOR_SETS]{};
+			VkBuffer			vertexBuffers[MAX_VERTEX_BINDINGS]{};
+			VkBuffer			indexBuffer = VK_NULL_HANDLE;
+			VkIndexType			indexType = VK_INDEX_TYPE_MAX_ENUM;
+			StateChangeStats	stats{};
+	};
+
+	class RenderQueue;
+	struct DrawPacket;
+
+	//a system that submits packets, it gets them back sorted to record the draws
+	class QueueEmitter
+	{
+		public:
+			//packets are consecutive ones of this emitter, a frame can call it several times
+			virtual void emit(s_frame_info &frameInfo, const DrawPacket *packets, size_t count, RenderState &state) = 0;
+
+		protected:
+			~QueueEmitter() = default;
+	};
+
+	struct DrawPacket
+	{
+		uint64_t		key;
+		QueueEmitter	*emitter;
+		uint32_t		item; //meaning is up to the emitter, usually an index in its own per frame data
+	};
+
+	//draws of every system in one list, ordered by a 64 bit key so state changes happen as rarely as possible
+	//opaque keys :      pass 2 | pipeline 8 | material 12 | mesh 20 | depth 22, front to back
+	//transparent keys : pass 2 | depth 22 | pipeline 8 | material 12 | mesh 20, back to front wins over state
+	class RenderQueue
+	{
+		public:
+			enum Pass : uint32_t
+			{
+				PASS_OPAQUE = 0,
+				PASS_TRANSPARENT = 1,
+			};
+
+			static constexpr uint32_t PIPELINE_BITS = 8;
+			static constexpr uint32_t MATERIAL_BITS = 12;
+			static constexpr uint32_t MESH_BITS = 20;
+			static constexpr uint32_t DEPTH_BITS = 22;
+
+			//fields are masked to their width, depth is any positive distance (squared is fine, only the order counts)
+			static uint64_t opaqueKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+			static uint64_t transparentKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+			void clear() { packets.clear(); }
+			void submit(uint64_t key, QueueEmitter &emitter, uint32_t item) { packets.push_back({key, &emitter, item}); }
+			//lsd radix sort, 8 bits per pass, passes where every key has the same byte are skipped
+			//stable, packets with equal keys keep their submission order
+			void sort();
+			//hands every run of consecutive packets of one emitter to it, in key order
+			void execute(s_frame_info &frameInfo, RenderState &state);
+
+			const std::vector<DrawPacket> &getPackets() const { return packets; }
+
+		private:
+			std::vector<DrawPacket> packets;
+			std::vector<DrawPacket> scratch; //kept to reuse the allocation
+	};
+}
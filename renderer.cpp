@@ -46,7 +46,7 @@ namespace wind
 			extent = appWindow.getExtent();
 			glfwWaitEvents();
 		}
-		vkDeviceWaitIdle(device.device());
+		device.waitIdle();
 
 		if (swapchain == nullptr)
 			swapchain = std::make_unique<LveSwapChain>(device, extent);
@@ -97,6 +97,7 @@ namespace wind
 		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
 			throw std::runtime_error("failed to record command buffer");
 		auto result = swapchain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+		submittedFrames++; //out of date only concerns the present, the commands were submitted
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || appWindow.wasWindowResized())
 		{
 			appWindow.resetWindowResizedFlag();
@@ -28,6 +28,7 @@ namespace wind
 
 			VkRenderPass getSwapChainRenderPass() const { return swapchain->getRenderPass(); }
 			float getAspectRatio() const { return swapchain->extentAspectRatio(); }
+			VkExtent2D getSwapChainExtent() const { return swapchain->getSwapChainExtent(); }
 			bool isFrameInProgress() const { return(isFrameStarted); }
 			VkCommandBuffer getCurrentCommandBuffer() const {
 				assert(isFrameStarted && "Can't get command buffer is frame is not in progress");
@@ -41,6 +42,8 @@ namespace wind
 				assert(isFrameStarted && "Can't get frame index when frame not in prog");
 				return currentFrameIndex;
 			}
+			//frames that reached the queue since the start, beginFrame returning nullptr does not count
+			uint64_t getSubmittedFrameCount() const { return submittedFrames; }
 
 		private:
 			void CreateCommandBuffers();
@@ -55,6 +58,7 @@ namespace wind
 			uint32_t currentImageIndex;
 			int	currentFrameIndex = 0;
 			bool isFrameStarted = false;
+			uint64_t submittedFrames = 0;
 
 			// Pipeline pipeline{
 			// 	device,
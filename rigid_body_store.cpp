@@ -0,0 +1,238 @@
+#include "rigid_body_store.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define WIND_BODIES_X86 1
+#endif
+
+namespace wind
+{
+	void RigidBodyStore::resize(size_t count)
+	{
+		entities.resize(count);
+		for (std::vector<float> *array : {&positionX, &positionY, &positionZ, &previousX, &previousY, &previousZ,
+			&velocityX, &velocityY, &velocityZ, &accelerationX, &accelerationY, &accelerationZ, &inverseMass})
+			array->resize(count);
+		flags.resize(count);
+		restTicks.resize(count);
+	}
+
+	size_t RigidBodyStore::add(Entity entity, const glm::vec3 &position)
+	{
+		const size_t i = size();
+		resize(i + 1);
+		entities[i] = entity;
+		positionX[i] = previousX[i] = position.x;
+		positionY[i] = previousY[i] = position.y;
+		positionZ[i] = previousZ[i] = position.z;
+		velocityX[i] = velocityY[i] = velocityZ[i] = 0.f;
+		accelerationX[i] = accelerationY[i] = accelerationZ[i] = 0.f;
+		inverseMass[i] = 0.f;
+		flags[i] = 0;
+		restTicks[i] = 0;
+		return i;
+	}
+
+	void RigidBodyStore::swapRemove(size_t i)
+	{
+		const size_t last = size() - 1;
+		entities[i] = entities[last];
+		for (std::vector<float> *array : {&positionX, &positionY, &positionZ, &previousX, &previousY, &previousZ,
+			&velocityX, &velocityY, &velocityZ, &accelerationX, &accelerationY, &accelerationZ, &inverseMass})
+			(*array)[i] = (*array)[last];
+		flags[i] = flags[last];
+		restTicks[i] = restTicks[last];
+		resize(last);
+	}
+
+	namespace
+	{
+		//the reference, also the tail of the simd kernels, same operations in the same order as they do
+		void integrateScalar(RigidBodyStore &store, float dt, float floorY, size_t first)
+		{
+			for (size_t i = first; i < store.size(); i++)
+			{
+				store.previousX[i] = store.positionX[i];
+				store.previousY[i] = store.positionY[i];
+				store.previousZ[i] = store.positionZ[i];
+				if (store.flags[i] & BODY_FROZEN)
+					continue;
+				store.velocityX[i] += store.accelerationX[i] * dt;
+				store.velocityY[i] += (store.accelerationY[i] + GRAVITY) * dt;
+				store.velocityZ[i] += store.accelerationZ[i] * dt;
+				store.positionX[i] += store.velocityX[i] * dt;
+				store.positionY[i] += store.velocityY[i] * dt;
+				store.positionZ[i] += store.velocityZ[i] * dt;
+				if (store.positionY[i] >= floorY && !(store.flags[i] & BODY_COLLIDES)) //clamped every tick, a body can't go through the floor
+				{
+					store.positionY[i] = floorY;
+					if (store.velocityY[i] > 0.f)
+						store.velocityY[i] = 0.f;
+				}
+			}
+		}
+
+#ifdef WIND_BODIES_X86
+		//no fma on purpose, a fused multiply add would round differently from the scalar path
+		__attribute__((target("avx2")))
+		size_t integrateAvx2(RigidBodyStore &store, float dt, float floorY)
+		{
+			const size_t count = store.size();
+			const __m256 step = _mm256_set1_ps(dt);
+			const __m256 floor = _mm256_set1_ps(floorY);
+			const __m256 gravity = _mm256_set1_ps(GRAVITY);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256i frozenBits = _mm256_set1_epi32(BODY_FROZEN);
+			const __m256i collidesBits = _mm256_set1_epi32(BODY_COLLIDES);
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 px = _mm256_loadu_ps(&store.positionX[i]);
+				__m256 py = _mm256_loadu_ps(&store.positionY[i]);
+				__m256 pz = _mm256_loadu_ps(&store.positionZ[i]);
+				_mm256_storeu_ps(&store.previousX[i], px);
+				_mm256_storeu_ps(&store.previousY[i], py);
+				_mm256_storeu_ps(&store.previousZ[i], pz);
+
+				__m256i flags = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&store.flags[i]));
+				__m256 dynamic = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(flags, frozenBits), _mm256_setzero_si256()));
+				__m256 clamped = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(flags, collidesBits), _mm256_setzero_si256()));
+
+				__m256 vx = _mm256_loadu_ps(&store.velocityX[i]);
+				__m256 vy = _mm256_loadu_ps(&store.velocityY[i]);
+				__m256 vz = _mm256_loadu_ps(&store.velocityZ[i]);
+				__m256 movedVx = _mm256_add_ps(vx, _mm256_mul_ps(_mm256_loadu_ps(&store.accelerationX[i]), step));
+				__m256 movedVy = _mm256_add_ps(vy, _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&store.accelerationY[i]), gravity), step));
+				__m256 movedVz = _mm256_add_ps(vz, _mm256_mul_ps(_mm256_loadu_ps(&store.accelerationZ[i]), step));
+				__m256 movedPx = _mm256_add_ps(px, _mm256_mul_ps(movedVx, step));
+				__m256 movedPy = _mm256_add_ps(py, _mm256_mul_ps(movedVy, step));
+				__m256 movedPz = _mm256_add_ps(pz, _mm256_mul_ps(movedVz, step));
+				//min with zero first keeps a -0 velocity like the scalar test does
+				__m256 landed = _mm256_and_ps(_mm256_cmp_ps(movedPy, floor, _CMP_GE_OQ), clamped);
+				movedPy = _mm256_blendv_ps(movedPy, floor, landed);
+				movedVy = _mm256_blendv_ps(movedVy, _mm256_min_ps(zero, movedVy), landed);
+
+				vx = _mm256_blendv_ps(vx, movedVx, dynamic);
+				vy = _mm256_blendv_ps(vy, movedVy, dynamic);
+				vz = _mm256_blendv_ps(vz, movedVz, dynamic);
+				px = _mm256_blendv_ps(px, movedPx, dynamic);
+				py = _mm256_blendv_ps(py, movedPy, dynamic);
+				pz = _mm256_blendv_ps(pz, movedPz, dynamic);
+
+				_mm256_storeu_ps(&store.velocityX[i], vx);
+				_mm256_storeu_ps(&store.velocityY[i], vy);
+				_mm256_storeu_ps(&store.velocityZ[i], vz);
+				_mm256_storeu_ps(&store.positionX[i], px);
+				_mm256_storeu_ps(&store.positionY[i], py);
+				_mm256_storeu_ps(&store.positionZ[i], pz);
+			}
+			return i;
+		}
+
+		__attribute__((target("sse4.1")))
+		size_t integrateSse41(RigidBodyStore &store, float dt, float floorY)
+		{
+			const size_t count = store.size();
+			const __m128 step = _mm_set1_ps(dt);
+			const __m128 floor = _mm_set1_ps(floorY);
+			const __m128 gravity = _mm_set1_ps(GRAVITY);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128i frozenBits = _mm_set1_epi32(BODY_FROZEN);
+			const __m128i collidesBits = _mm_set1_epi32(BODY_COLLIDES);
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 px = _mm_loadu_ps(&store.positionX[i]);
+				__m128 py = _mm_loadu_ps(&store.positionY[i]);
+				__m128 pz = _mm_loadu_ps(&store.positionZ[i]);
+				_mm_storeu_ps(&store.previousX[i], px);
+				_mm_storeu_ps(&store.previousY[i], py);
+				_mm_storeu_ps(&store.previousZ[i], pz);
+
+				__m128i flags = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&store.flags[i]));
+				__m128 dynamic = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(flags, frozenBits), _mm_setzero_si128()));
+				__m128 clamped = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(flags, collidesBits), _mm_setzero_si128()));
+
+				__m128 vx = _mm_loadu_ps(&store.velocityX[i]);
+				__m128 vy = _mm_loadu_ps(&store.velocityY[i]);
+				__m128 vz = _mm_loadu_ps(&store.velocityZ[i]);
+				__m128 movedVx = _mm_add_ps(vx, _mm_mul_ps(_mm_loadu_ps(&store.accelerationX[i]), step));
+				__m128 movedVy = _mm_add_ps(vy, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&store.accelerationY[i]), gravity), step));
+				__m128 movedVz = _mm_add_ps(vz, _mm_mul_ps(_mm_loadu_ps(&store.accelerationZ[i]), step));
+				__m128 movedPx = _mm_add_ps(px, _mm_mul_ps(movedVx, step));
+				__m128 movedPy = _mm_add_ps(py, _mm_mul_ps(movedVy, step));
+				__m128 movedPz = _mm_add_ps(pz, _mm_mul_ps(movedVz, step));
+				__m128 landed = _mm_and_ps(_mm_cmpge_ps(movedPy, floor), clamped);
+				movedPy = _mm_blendv_ps(movedPy, floor, landed);
+				movedVy = _mm_blendv_ps(movedVy, _mm_min_ps(zero, movedVy), landed);
+
+				vx = _mm_blendv_ps(vx, movedVx, dynamic);
+				vy = _mm_blendv_ps(vy, movedVy, dynamic);
+				vz = _mm_blendv_ps(vz, movedVz, dynamic);
+				px = _mm_blendv_ps(px, movedPx, dynamic);
+				py = _mm_blendv_ps(py, movedPy, dynamic);
+				pz = _mm_blendv_ps(pz, movedPz, dynamic);
+
+				_mm_storeu_ps(&store.velocityX[i], vx);
+				_mm_storeu_ps(&store.velocityY[i], vy);
+				_mm_storeu_ps(&store.velocityZ[i], vz);
+				_mm_storeu_ps(&store.positionX[i], px);
+				_mm_storeu_ps(&store.positionY[i], py);
+				_mm_storeu_ps(&store.positionZ[i], pz);
+			}
+			return i;
+		}
+#endif
+	}
+
+	bool isKernelSupported(IntegrationKernel kernel)
+	{
+		switch (kernel)
+		{
+			case IntegrationKernel::Scalar:
+				return true;
+#ifdef WIND_BODIES_X86
+			case IntegrationKernel::Sse41:
+				return __builtin_cpu_supports("sse4.1");
+			case IntegrationKernel::Avx2:
+				return __builtin_cpu_supports("avx2");
+#endif
+			default:
+				return false;
+		}
+	}
+
+	IntegrationKernel bestIntegrationKernel()
+	{
+		static const IntegrationKernel best = isKernelSupported(IntegrationKernel::Avx2) ? IntegrationKernel::Avx2
+			: isKernelSupported(IntegrationKernel::Sse41) ? IntegrationKernel::Sse41 : IntegrationKernel::Scalar;
+		return best;
+	}
+
+	const char *kernelName(IntegrationKernel kernel)
+	{
+		switch (kernel)
+		{
+			case IntegrationKernel::Sse41: return "sse4.1";
+			case IntegrationKernel::Avx2: return "avx2";
+			default: return "scalar";
+		}
+	}
+
+	void integrateBodies(RigidBodyStore &store, float dt, float floorY)
+	{
+		integrateBodies(store, dt, floorY, bestIntegrationKernel());
+	}
+
+	void integrateBodies(RigidBodyStore &store, float dt, float floorY, IntegrationKernel kernel)
+	{
+		size_t first = 0;
+#ifdef WIND_BODIES_X86
+		if (kernel == IntegrationKernel::Avx2)
+			first = integrateAvx2(store, dt, floorY);
+		else if (kernel == IntegrationKernel::Sse41)
+			first = integrateSse41(store, dt, floorY);
+#endif
+		integrateScalar(store, dt, floorY, first);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "scene.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wind
+{
+	enum RigidBodyFlags : uint32_t
+	{
+		BODY_STATIC = 1, //mass EARTH, never integrated
+		BODY_SLEEPING = 2, //came to rest, skipped until something hits it
+		BODY_FROZEN = BODY_STATIC | BODY_SLEEPING,
+		BODY_COLLIDES = 4, //has a collider, the collisions keep it above the floor and the hard clamp is skipped
+	};
+
+	//rigid bodies of the scene one array per component, so the integration loads 8 (avx2) or 4 (sse) bodies at once
+	//PhysicsStepper owns one for the whole run : bodies are added when their RigidBodyComponent appears and
+	//removed (swap with the last) when it goes away, their state only ever lives here
+	struct RigidBodyStore
+	{
+		std::vector<Entity>		entities;
+		std::vector<float>		positionX, positionY, positionZ;
+		std::vector<float>		previousX, previousY, previousZ; //before the last tick
+		std::vector<float>		velocityX, velocityY, velocityZ;
+		std::vector<float>		accelerationX, accelerationY, accelerationZ; //on top of gravity
+		std::vector<float>		inverseMass; //0 for static bodies
+		std::vector<uint32_t>	flags;
+		std::vector<uint32_t>	restTicks; //consecutive ticks under the sleep speed
+
+		size_t size() const { return entities.size(); }
+		void resize(size_t count);
+		//appends a body at rest at position, returns its index
+		size_t add(Entity entity, const glm::vec3 &position);
+		//the last body takes its index
+		void swapRemove(size_t i);
+	};
+
+	enum class IntegrationKernel
+	{
+		Scalar,
+		Sse41, //4 bodies per instruction
+		Avx2, //8 bodies per instruction
+	};
+
+	//what the cpu running us can do, checked once
+	bool isKernelSupported(IntegrationKernel kernel);
+	IntegrationKernel bestIntegrationKernel();
+	const char *kernelName(IntegrationKernel kernel);
+
+	//one tick of every body that is not frozen : gravity and acceleration, then bodies without a collider are clamped
+	//to floorY (y points down) where the downward velocity is dropped, infinity for no floor
+	//all kernels give bit identical results, the default one is bestIntegrationKernel()
+	void integrateBodies(RigidBodyStore &store, float dt, float floorY);
+	void integrateBodies(RigidBodyStore &store, float dt, float floorY, IntegrationKernel kernel);
+}
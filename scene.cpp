@@ -0,0 +1,81 @@
+#include "scene.hpp"
+
+#include <stdexcept>
+
+namespace wind
+{
+	Entity Scene::createEntity()
+	{
+		uint32_t slot;
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			if (generations.size() >= MAX_ENTITIES)
+				throw std::runtime_error("too many entities");
+			slot = static_cast<uint32_t>(generations.size());
+			generations.push_back(0);
+		}
+		Entity entity = (generations[slot] << ENTITY_INDEX_BITS) | slot;
+		transforms.add(entity);
+		return entity;
+	}
+
+	Entity Scene::createPointLight(float intensity, glm::vec3 color, float radius)
+	{
+		Entity entity = createEntity();
+		transforms.get(entity)->scale = radius;
+		pointLights.add(entity, {color, intensity});
+		return entity;
+	}
+
+	bool Scene::isAlive(Entity entity) const
+	{
+		//freed slots already carry the next generation, so the old handle fails here too
+		const uint32_t slot = entityIndex(entity);
+		return slot < generations.size() && generations[slot] == entityGeneration(entity) && transforms.has(entity);
+	}
+
+	void Scene::destroy(Entity entity)
+	{
+		if (isAlive(entity))
+			pendingDestroy.push_back(entity);
+	}
+
+	size_t Scene::flushDestroyed()
+	{
+		size_t destroyed = 0;
+		for (Entity entity : pendingDestroy)
+		{
+			if (!isAlive(entity)) //destroyed twice in the same frame
+				continue;
+			transforms.remove(entity);
+			meshes.remove(entity);
+			pointLights.remove(entity);
+			rigidBodies.remove(entity);
+			players.remove(entity);
+			lifetimes.remove(entity);
+			colliders.remove(entity);
+
+			const uint32_t slot = entityIndex(entity);
+			generations[slot] = (generations[slot] + 1) & ENTITY_GENERATION_MASK;
+			freeSlots.push_back(slot);
+			destroyed++;
+		}
+		pendingDestroy.clear();
+		return destroyed;
+	}
+
+	void Scene::updateLifetimes(float dt)
+	{
+		for (size_t i = 0; i < lifetimes.size(); i++)
+		{
+			lifetimes[i].remaining -= dt;
+			if (lifetimes[i].remaining <= 0.f)
+				destroy(lifetimes.entity(i));
+		}
+	}
+}
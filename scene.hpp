@@ -0,0 +1,122 @@
+#pragma once
+
+#include "game_object.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace wind
+{
+	//generational handle : low bits are the slot, high bits count how many times the slot was reused
+	//a handle kept after its entity was destroyed no longer matches the slot generation and finds nothing
+	using Entity = uint32_t;
+	constexpr uint32_t ENTITY_INDEX_BITS = 20;
+	constexpr uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+	constexpr uint32_t ENTITY_GENERATION_MASK = (1u << (32 - ENTITY_INDEX_BITS)) - 1;
+	constexpr uint32_t MAX_ENTITIES = ENTITY_INDEX_MASK; //the last slot is never handed out, NULL_ENTITY lives there
+	constexpr Entity NULL_ENTITY = UINT32_MAX;
+
+	inline uint32_t entityIndex(Entity entity) { return entity & ENTITY_INDEX_MASK; }
+	inline uint32_t entityGeneration(Entity entity) { return entity >> ENTITY_INDEX_BITS; }
+
+	//sparse set : components are packed in a dense array, iterating it touches only entities that have one
+	//sparse maps an entity slot to its dense index, removal moves the last component into the hole
+	//the dense side keeps the full handle so a stale one is told apart from the entity now in its slot
+	template<typename T>
+	class ComponentPool
+	{
+		public:
+			//replaces the component when the entity already has one
+			T &add(Entity entity, T component = T{})
+			{
+				const uint32_t slot = entityIndex(entity);
+				if (slot >= sparse.size())
+					sparse.resize(slot + 1, NONE);
+				changes++;
+				if (has(entity))
+					return components[sparse[slot]] = std::move(component);
+				sparse[slot] = static_cast<uint32_t>(components.size());
+				entities.push_back(entity);
+				components.push_back(std::move(component));
+				return components.back();
+			}
+
+			void remove(Entity entity)
+			{
+				if (!has(entity))
+					return;
+				const uint32_t slot = entityIndex(entity);
+				const uint32_t index = sparse[slot];
+				const Entity last = entities.back();
+				components[index] = std::move(components.back());
+				entities[index] = last;
+				sparse[entityIndex(last)] = index;
+				components.pop_back();
+				entities.pop_back();
+				sparse[slot] = NONE;
+				changes++;
+			}
+
+			bool has(Entity entity) const
+			{
+				const uint32_t slot = entityIndex(entity);
+				return slot < sparse.size() && sparse[slot] != NONE && entities[sparse[slot]] == entity;
+			}
+			//null when the entity has none, stays valid until a component of this type is added or removed
+			T *get(Entity entity) { return has(entity) ? &components[sparse[entityIndex(entity)]] : nullptr; }
+			const T *get(Entity entity) const { return has(entity) ? &components[sparse[entityIndex(entity)]] : nullptr; }
+
+			//dense access, index i belongs to entity(i)
+			size_t size() const { return components.size(); }
+			Entity entity(size_t i) const { return entities[i]; }
+			T &operator[](size_t i) { return components[i]; }
+			const T &operator[](size_t i) const { return components[i]; }
+			typename std::vector<T>::iterator begin() { return components.begin(); }
+			typename std::vector<T>::iterator end() { return components.end(); }
+			//goes up on every add and remove, systems keeping their own copy of a pool only look at it again when it moved
+			uint64_t getChangeCount() const { return changes; }
+
+		private:
+			static constexpr uint32_t NONE = UINT32_MAX;
+
+			std::vector<uint32_t>	sparse;
+			std::vector<Entity>		entities;
+			std::vector<T>			components;
+			uint64_t				changes = 0;
+	};
+
+	//every entity of the world and one pool per component type, systems walk the pool they care about
+	//and look the other components up through the entity
+	//slots of destroyed entities are reused through a free list, once the vectors reached the peak entity count
+	//creating and destroying entities does not allocate anymore
+	class Scene
+	{
+		public:
+			Entity createEntity(); //comes with an identity transform
+			Entity createPointLight(float intensity = 10.f, glm::vec3 color = glm::vec3(1.f), float radius = 0.1f);
+
+			bool isAlive(Entity entity) const;
+			//O(1), the entity stays alive until flushDestroyed so systems iterating the pools this frame are not disturbed
+			void destroy(Entity entity);
+			//call between frames : removes the components of every destroyed entity and frees their slots
+			size_t flushDestroyed();
+			//counts down every lifetime and destroys the entities that ran out
+			void updateLifetimes(float dt);
+
+			size_t aliveCount() const { return generations.size() - freeSlots.size(); }
+			size_t freeSlotCount() const { return freeSlots.size(); }
+
+			ComponentPool<TransformComponent>	transforms;
+			ComponentPool<MeshComponent>		meshes;
+			ComponentPool<PointLightComponent>	pointLights;
+			ComponentPool<RigidBodyComponent>	rigidBodies;
+			ComponentPool<PlayerComponent>		players;
+			ComponentPool<LifetimeComponent>	lifetimes;
+			ComponentPool<ColliderComponent>	colliders;
+
+		private:
+			std::vector<uint32_t>	generations; //current generation of each slot
+			std::vector<uint32_t>	freeSlots; //used as a stack, the slot freed last is reused first while its pool entries are warm
+			std::vector<Entity>		pendingDestroy;
+	};
+}
@@ -20,11 +20,6 @@ layout(set = 0, binding = 0) uniform GlobalUBO {
 	int lightCount;
 } ubo;
 
-layout(push_constant) uniform Push {
-	mat4 modelMatrix;
-	mat4 normalMatrix;
-} push;
-
 void main()
 {
 	vec3 diffuseLight = ubo.ambientLight.xyz * ubo.ambientLight.w;
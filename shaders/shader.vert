@@ -23,19 +23,29 @@ layout(set = 0, binding = 0) uniform GlobalUBO {
 	int lightCount;
 } ubo;
 
+//one entry per drawn object this frame, written by SimpleRenderSystem
+struct ObjectData {
+	mat4 modelMatrix; //dequantize already folded in
+	mat4 normalMatrix;
+};
 
+layout(std430, set = 1, binding = 0) readonly buffer Objects {
+	ObjectData objects[];
+};
+
+//gl_InstanceIndex already counts from firstInstance, objectBase is only set when indirect draws can't use firstInstance
 layout(push_constant) uniform Push {
-	mat4 modelMatrix;
-	mat4 normalMatrix;
+	uint objectBase;
 } push;
 
 
 void main()
 {
-	vec4 vertexWorldSpace = push.modelMatrix * vec4(position, 1.0);
+	ObjectData object = objects[push.objectBase + gl_InstanceIndex];
+	vec4 vertexWorldSpace = object.modelMatrix * vec4(position, 1.0);
 	gl_Position = ubo.projection * ubo.view * vertexWorldSpace;
 
-	fragWorldNormal = normalize(mat3(push.normalMatrix) * normal);
+	fragWorldNormal = normalize(mat3(object.normalMatrix) * normal);
 	fragWorldPos = vertexWorldSpace.xyz;
 	fragColor = color;
 }
@@ -0,0 +1,60 @@
+#version 450 
+
+//same as shader.vert but for LveModel::CompactVertex, position is dequantized by the model matrix
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 normal; //octahedral
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragWorldPos;
+layout(location = 2) out vec3 fragWorldNormal;
+
+struct PointLight {
+	vec4 position;
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUBO {
+	mat4 projection;
+	mat4 view;
+	mat4 inverseView;
+	vec4 ambientLight;
+	PointLight pointLights[10]; //look into speciliazition constants
+	int lightCount;
+} ubo;
+
+//one entry per drawn object this frame, written by SimpleRenderSystem
+struct ObjectData {
+	mat4 modelMatrix; //dequantize already folded in
+	mat4 normalMatrix;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Objects {
+	ObjectData objects[];
+};
+
+//gl_InstanceIndex already counts from firstInstance, objectBase is only set when indirect draws can't use firstInstance
+layout(push_constant) uniform Push {
+	uint objectBase;
+} push;
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main()
+{
+	ObjectData object = objects[push.objectBase + gl_InstanceIndex];
+	vec4 vertexWorldSpace = object.modelMatrix * vec4(position.xyz, 1.0);
+	gl_Position = ubo.projection * ubo.view * vertexWorldSpace;
+
+	fragWorldNormal = normalize(mat3(object.normalMatrix) * octDecode(normal));
+	fragWorldPos = vertexWorldSpace.xyz;
+	fragColor = color.rgb;
+}
@@ -1,4 +1,5 @@
 #include "simple_render_system.hpp"
+#include <algorithm>
 #include <array>
 #include <iostream>
 
@@ -9,32 +10,84 @@
 
 namespace wind
 {
+	//the transforms are in the object buffer, this only offsets gl_InstanceIndex for indirect draws
+	//on devices where their firstInstance has to stay 0
 	struct SimplePushConstantData
 	{
-		glm::mat4 modelMatrix{1.f}; 
-		glm::mat4 normalMatrix{1.f}; 
+		uint32_t objectBase = 0;
 	};
 
 	SimpleRenderSystem::SimpleRenderSystem(EngineDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : device{device} 
 	{
 		CreatePipelineLayout(globalSetLayout);
 		CreatePipeline(renderPass);
+		createIndirectBuffers();
+		createObjectBuffers();
+		if (GpuCulling::isSupported(device))
+			gpuCulling = std::make_unique<GpuCulling>(device, objectSetLayout);
 	}
 
 	SimpleRenderSystem::~SimpleRenderSystem()
 	{
+		for (t_buffer &buffer : indirectBuffers)
+			destroy_buffer(buffer, device);
+		for (t_buffer &buffer : objectBuffers)
+			destroy_buffer(buffer, device);
+		objectDescriptorPool.destroy_pools(device);
 		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device.device(), objectSetLayout, nullptr);
+	}
+
+	void SimpleRenderSystem::createIndirectBuffers()
+	{
+		VkDeviceSize size = sizeof(VkDrawIndexedIndirectCommand) * MAX_INDIRECT_DRAWS;
+		for (t_buffer &buffer : indirectBuffers)
+		{
+			initialise_buffer(buffer, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				device, size);
+		}
+	}
+
+	void SimpleRenderSystem::createObjectBuffers()
+	{
+		VkDeviceSize size = sizeof(ObjectData) * MAX_OBJECTS;
+		std::vector<DescriptorPool::PoolSizeRatio> poolRatios = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}};
+		objectDescriptorPool.init(device, LveSwapChain::MAX_FRAMES_IN_FLIGHT, poolRatios);
+		for (int i = 0; i < LveSwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			initialise_buffer(objectBuffers[i], VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				device, size);
+			DescriptorWriter writer{};
+			VkDescriptorBufferInfo bufferInfo{};
+			writer.write_buffer(0, objectBuffers[i].buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfo);
+			objectDescriptorPool.allocate(device, objectSetLayout, objectDescriptorSets[i], nullptr);
+			writer.update_set(device, objectDescriptorSets[i]);
+		}
 	}
 
 
 	void SimpleRenderSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout)
 	{
 		VkPushConstantRange pushConstantRange {};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 		pushConstantRange.offset = 0;
 		pushConstantRange.size = sizeof(SimplePushConstantData);
 
-		std::vector<VkDescriptorSetLayout> descriptorSetsLayouts{globalSetLayout}; //vector might be avoidable here 
+		VkDescriptorSetLayoutBinding objectBinding{};
+		objectBinding.binding = 0;
+		objectBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		objectBinding.descriptorCount = 1;
+		objectBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		VkDescriptorSetLayoutCreateInfo objectLayoutInfo{};
+		objectLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		objectLayoutInfo.bindingCount = 1;
+		objectLayoutInfo.pBindings = &objectBinding;
+		if (vkCreateDescriptorSetLayout(device.device(), &objectLayoutInfo, nullptr, &objectSetLayout) != VK_SUCCESS)
+			throw std::runtime_error("failed to create descriptor set layout");
+
+		std::vector<VkDescriptorSetLayout> descriptorSetsLayouts{globalSetLayout, objectSetLayout}; //vector might be avoidable here 
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -50,71 +103,280 @@ namespace wind
 	{
 		assert(pipelineLayout != nullptr && "Can't create pipeline before pipolino layout");
 
-		PipelineConfigInfo pipelineConfig{};
-		Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+		for (int i = 0; i < LveModel::VERTEX_FORMAT_COUNT; i++)
+		{
+			auto format = static_cast<LveModel::VertexFormat>(i);
+			PipelineConfigInfo pipelineConfig{};
+			Pipeline::defaultPipelineConfigInfo(pipelineConfig);
 
-		pipelineConfig.renderPass = renderPass;
-		pipelineConfig.pipelineLayout = pipelineLayout;
-		pipeline = std::make_unique<Pipeline>(
-			device,
-			"shaders/shader.vert.spv",
-			"shaders/frag.frag.spv",
-			pipelineConfig);
+			pipelineConfig.bindingDescriptions = LveModel::getBindingDescriptions(format);
+			pipelineConfig.attributeDescriptions = LveModel::getAttributeDescriptions(format);
+			pipelineConfig.renderPass = renderPass;
+			pipelineConfig.pipelineLayout = pipelineLayout;
+			backfaceCulling = (pipelineConfig.rasterizationInfo.cullMode & VK_CULL_MODE_BACK_BIT) != 0;
+			pipelines[i] = std::make_unique<Pipeline>(
+				device,
+				format == LveModel::VertexFormat::Full ? "shaders/shader.vert.spv" : "shaders/shader_compact.vert.spv",
+				"shaders/frag.frag.spv",
+				pipelineConfig);
+		}
+	}
+
+	uint32_t SimpleRenderSystem::selectLod(const LveModel &model, const glm::mat4 &modelMatrix, float scale, const s_frame_info &frameInfo) const
+	{
+		if (model.getLodCount() <= 1 || frameInfo.viewportHeight <= 0.f)
+			return 0;
+		//closest point of the bounding sphere, so the error is never underestimated
+		glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(model.getBoundsCenter(), 1.f));
+		float distance = glm::length(center - frameInfo.camera.getPosition()) - model.getBoundsRadius() * scale;
+		if (distance <= 0.f)
+			return 0;
+		//lod errors only grow with the level, keep the last one that stays under the threshold
+		uint32_t lod = 0;
+		for (uint32_t level = 1; level < model.getLodCount(); level++)
+		{
+			float error = frameInfo.camera.projectedSize(model.getLod(level).error * scale, distance, frameInfo.viewportHeight);
+			if (error > lodErrorThreshold)
+				break;
+			lod = level;
+		}
+		return lod;
 	}
 
-	void SimpleRenderSystem::applyPhysics(s_frame_info &frameInfo, GlobalUBO &ubo)
+	bool SimpleRenderSystem::drawMeshlets(const LveModel &model, const glm::mat4 &modelMatrix, float scale, const s_frame_info &frameInfo, uint32_t objectIndex)
 	{
-		auto &dt = frameInfo.frameTime;
-		for (auto &kv : frameInfo.gameObjects)
+		const auto &meshlets = model.getMeshlets();
+		if (meshlets.empty() || indirectCursor + meshlets.size() > MAX_INDIRECT_DRAWS)
+			return false;
+
+		glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+		auto *commands = static_cast<VkDrawIndexedIndirectCommand *>(indirectBuffers[frameInfo.frameIndex].data);
+		const uint32_t firstDraw = indirectCursor;
+		//without drawIndirectFirstInstance the commands must use 0, the object index goes through the push constant instead
+		const bool firstInstance = device.enabledFeatures.drawIndirectFirstInstance;
+
+		for (const auto &meshlet : meshlets)
 		{
-			auto &obj = kv.second;
-			if (obj.mass == -1.0 || obj.mass == EARTH)
+			glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(meshlet.center, 1.f));
+			float radius = meshlet.radius * scale;
+			bool visible = true;
+			for (int i = 0; i < 6 && visible; i++)
+				visible = glm::dot(glm::vec3(frustumPlanes[i]), center) + frustumPlanes[i].w >= -radius;
+			if (visible && backfaceCulling && meshlet.coneCutoff < 1.f)
+			{
+				//the whole cone faces away from every point of the sphere
+				glm::vec3 axis = glm::normalize(glm::mat3(modelMatrix) * meshlet.coneAxis);
+				glm::vec3 toCluster = center - cameraPosition;
+				visible = glm::dot(toCluster, axis) < meshlet.coneCutoff * glm::length(toCluster) + radius;
+			}
+			if (!visible)
+			{
+				stats.clustersCulled++;
 				continue;
-			if (obj.transform.translation.y < floor_y)
+			}
+			stats.clustersDrawn++;
+
+			//visible neighbours are neighbouring index ranges, grow the last command instead of adding one
+			VkDrawIndexedIndirectCommand *last = indirectCursor > firstDraw ? &commands[indirectCursor - 1] : nullptr;
+			if (last != nullptr && last->firstIndex + last->indexCount == model.getFirstIndex() + meshlet.firstIndex)
 			{
-				obj.speed.y += GRAVITY * dt;
-				obj.transform.translation += obj.speed * dt;
-				if (obj.transform.translation.y > floor_y)
-					obj.transform.translation.y = floor_y;
+				last->indexCount += meshlet.indexCount;
+				continue;
 			}
-			else
+			commands[indirectCursor++] = {meshlet.indexCount, 1, model.getFirstIndex() + meshlet.firstIndex, model.getVertexOffset(),
+				firstInstance ? objectIndex : 0};
+		}
+
+		const uint32_t drawCount = indirectCursor - firstDraw;
+		const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+		const VkDeviceSize offset = firstDraw * stride;
+		VkBuffer buffer = indirectBuffers[frameInfo.frameIndex].buffer;
+		if (drawCount == 0)
+			return true;
+		if (!firstInstance)
+		{
+			SimplePushConstantData push{objectIndex};
+			vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SimplePushConstantData), &push);
+		}
+		if (device.enabledFeatures.multiDrawIndirect)
+		{
+			vkCmdDrawIndexedIndirect(frameInfo.commandBuffer, buffer, offset, drawCount, static_cast<uint32_t>(stride));
+			stats.drawCalls++;
+		}
+		else
+		{
+			stats.drawCalls += drawCount;
+			for (uint32_t i = 0; i < drawCount; i++)
+				vkCmdDrawIndexedIndirect(frameInfo.commandBuffer, buffer, offset + i * stride, 1, static_cast<uint32_t>(stride));
+		}
+		if (!firstInstance)
+		{
+			SimplePushConstantData push{};
+			vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SimplePushConstantData), &push);
+		}
+		return true;
+	}
+
+	void SimpleRenderSystem::cullGameObjects(s_frame_info &frameInfo)
+	{
+		gpuCulledFrame = gpuDriven && gpuCulling != nullptr;
+		if (!gpuCulledFrame)
+		{
+			if (gpuCulling != nullptr) //its records would keep the models alive
+				gpuCulling->clear();
+			return;
+		}
+		gpuLeftovers.clear();
+		gpuCulling->cull(frameInfo, lodErrorThreshold, gpuLeftovers);
+	}
+
+	void SimpleRenderSystem::submit(s_frame_info &frameInfo, RenderQueue &queue)
+	{
+		frameInfo.camera.getFrustumPlanes(frustumPlanes);
+		indirectCursor = 0;
+		//the gpu culled objects have their own resident object buffer
+		objectCursor = 0;
+		stats = RenderStats{};
+
+		candidates.clear();
+		if (gpuCulledFrame)
+		{
+			//the few objects the gpu did not take are not worth culling
+			for (Entity entity : gpuLeftovers)
 			{
-				obj.speed.y = 0;
+				TransformComponent &transform = *frameInfo.scene.transforms.get(entity);
+				candidates.push_back({frameInfo.scene.meshes.get(entity)->model.get(), &transform, transform.mat4()});
 			}
+			candidateVisible.assign(candidates.size(), 1);
+			//the gpu counts are a few frames old, good enough for the menu
+			stats.objectsDrawn = gpuCulling->getVisibleCount() + static_cast<uint32_t>(candidates.size());
+			stats.objectsCulled = gpuCulling->getObjectCount() - std::min(gpuCulling->getVisibleCount(), gpuCulling->getObjectCount());
+			queue.submit(RenderQueue::opaqueKey(0, 0, 0, 0.f), *this, GPU_CULLED_ITEM);
+		}
+		else
+		{
+			//world space bounding spheres of everything drawable, tested against the frustum all at once
+			candidateBounds.clear();
+			auto &meshes = frameInfo.scene.meshes;
+			for (size_t i = 0; i < meshes.size(); i++)
+			{
+				LveModel *model = meshes[i].model.get();
+				if (model == nullptr)
+					continue;
+				TransformComponent &transform = *frameInfo.scene.transforms.get(meshes.entity(i));
+				const glm::mat4 &modelMatrix = transform.mat4();
+				candidates.push_back({model, &transform, modelMatrix});
+				candidateBounds.push(glm::vec3(modelMatrix * glm::vec4(model->getBoundsCenter(), 1.f)),
+					model->getBoundsRadius() * glm::abs(transform.scale));
+			}
+			stats.objectsDrawn = static_cast<uint32_t>(cullSpheres(frustumPlanes, candidateBounds, candidateVisible));
+			stats.objectsCulled = static_cast<uint32_t>(candidates.size()) - stats.objectsDrawn;
+		}
+
+		//pipeline is the vertex format, material the index type (there is one descriptor set for everything),
+		//mesh the model and its lod so objects that can share an instanced draw end up next to each other
+		drawItems.clear();
+		meshIds.clear();
+		const glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			if (!candidateVisible[i])
+				continue;
+			LveModel &model = *candidates[i].model;
+			const glm::mat4 &modelMatrix = candidates[i].modelMatrix;
+			uint32_t lod = selectLod(model, modelMatrix, glm::abs(candidates[i].transform->scale), frameInfo);
+			uint32_t meshId = meshIds.emplace(&model, static_cast<uint32_t>(meshIds.size())).first->second;
+			glm::vec3 offset = glm::vec3(modelMatrix[3]) - cameraPosition;
+
+			uint64_t key = RenderQueue::opaqueKey(
+				static_cast<uint32_t>(model.getVertexFormat()),
+				model.getIndexType() == VK_INDEX_TYPE_UINT32 ? 1 : 0,
+				(meshId << 3) | lod,
+				glm::dot(offset, offset));
+			queue.submit(key, *this, static_cast<uint32_t>(drawItems.size()));
+			drawItems.push_back({&model, lod, static_cast<uint32_t>(i)});
 		}
 	}
 
-	void SimpleRenderSystem::renderGameObjects(s_frame_info &frameInfo)
+	void SimpleRenderSystem::emit(s_frame_info &frameInfo, const DrawPacket *packets, size_t count, RenderState &state)
 	{
-		pipeline->bind(frameInfo.commandBuffer);
-
-		vkCmdBindDescriptorSets(
-			frameInfo.commandBuffer,
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			pipelineLayout,
-			0, 1,
-			&frameInfo.globalDescriptorSet,
-			0, nullptr
-		);
-
-		for (auto &kv: frameInfo.gameObjects)
+		VkCommandBuffer commandBuffer = state.getCommandBuffer();
+		state.bindDescriptorSet(pipelineLayout, 0, frameInfo.globalDescriptorSet);
+		state.bindDescriptorSet(pipelineLayout, 1, objectDescriptorSets[frameInfo.frameIndex]);
+		//another system may have pushed its own constants in between
+		SimplePushConstantData push{};
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SimplePushConstantData), &push);
+
+		//objects are written in draw order, in one forward pass over the mapped buffer, so a group is a contiguous range
+		auto *objects = static_cast<ObjectData *>(objectBuffers[frameInfo.frameIndex].data);
+		//the packets come sorted, same model and lod are neighbours
+		for (size_t first = 0; first < count;)
 		{
-			auto &obj = kv.second;
-			if (obj.point_light_intensity != -1) //our simple way to check if the object is a point light
+			if (packets[first].item == GPU_CULLED_ITEM)
+			{
+				gpuCulling->draw(frameInfo, pipelines, pipelineLayout, state);
+				stats.drawCalls += gpuCulling->getDrawCalls();
+				state.bindDescriptorSet(pipelineLayout, 1, objectDescriptorSets[frameInfo.frameIndex]);
+				first++;
 				continue;
-			SimplePushConstantData push {};
-			push.modelMatrix = obj.transform.mat4();
-			push.normalMatrix = obj.transform.mat4();
-
-			vkCmdPushConstants(
-				frameInfo.commandBuffer,
-				pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-				0,
-				sizeof(SimplePushConstantData),
-				&push);
-			obj.model->bind(frameInfo.commandBuffer);
-			obj.model->draw(frameInfo.commandBuffer);
+			}
+			const DrawItem &item = drawItems[packets[first].item];
+			LveModel &model = *item.model;
+			const uint32_t lod = item.lod;
+			size_t end = first + 1;
+			while (end < count && packets[end].item != GPU_CULLED_ITEM
+				&& drawItems[packets[end].item].model == &model && drawItems[packets[end].item].lod == lod)
+				end++;
+			const uint32_t instanceCount = static_cast<uint32_t>(end - first);
+			if (objectCursor + instanceCount > MAX_OBJECTS) //object buffer full, the gpu batch may still follow
+			{
+				if (!warnedDropped)
+				{
+					std::cerr << "object buffer full (" << MAX_OBJECTS << "), objects are not drawn" << std::endl;
+					warnedDropped = true;
+				}
+				stats.objectsDropped += instanceCount;
+				first = end;
+				continue;
+			}
+
+			state.bindPipeline(*pipelines[static_cast<int>(model.getVertexFormat())]);
+			GeometryPool &geometry = model.getGeometryPool();
+			state.bindVertexBuffer(0, geometry.getVertexBuffer());
+			if (model.hasIndices())
+				state.bindIndexBuffer(geometry.getIndexBuffer(), model.getIndexType());
+
+			for (size_t i = first; i < end; i++)
+			{
+				DrawCandidate &candidate = candidates[drawItems[packets[i].item].candidate];
+				ObjectData &object = objects[objectCursor + (i - first)];
+				object.modelMatrix = candidate.modelMatrix * model.getDequantizeMatrix();
+				object.normalMatrix = candidate.transform->normalMatrix();
+			}
+
+			if (instanceCount >= MIN_INSTANCES)
+			{
+				//cluster culling is per object, a group draws its whole lod and lets the gpu reject what it must
+				model.draw(commandBuffer, lod, instanceCount, objectCursor);
+				stats.instancedObjects += instanceCount;
+				stats.drawCalls++;
+			}
+			else
+			{
+				for (size_t i = first; i < end; i++)
+				{
+					const DrawCandidate &candidate = candidates[drawItems[packets[i].item].candidate];
+					const uint32_t objectIndex = objectCursor + static_cast<uint32_t>(i - first);
+					//cluster culling only exists for the full resolution level, coarser ones are cheap enough already
+					if (lod != 0 || !drawMeshlets(model, candidate.modelMatrix, glm::abs(candidate.transform->scale), frameInfo, objectIndex))
+					{
+						model.draw(commandBuffer, lod, 1, objectIndex);
+						stats.drawCalls++;
+					}
+				}
+			}
+			objectCursor += instanceCount;
+			first = end;
 		}
 	}
 }
\ No newline at end of file
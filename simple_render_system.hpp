@@ -5,14 +5,33 @@
 #include "engine.hpp"
 #include "camera.hpp"
 #include "frame_info.hpp"
+#include "swap_chain.hpp"
+#include "initialise_buffers.hpp"
+#include "frustum_culling.hpp"
+#include "gpu_culling.hpp"
+#include "render_queue.hpp"
+#include "descriptors.hpp"
 
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <stdexcept>
 
 namespace wind
 {
-	class SimpleRenderSystem
+	struct RenderStats
+	{
+		uint32_t	objectsDrawn = 0; //objects whose bounding sphere touches the frustum
+		uint32_t	objectsCulled = 0;
+		uint32_t	clustersDrawn = 0; //meshlets kept and culled inside the drawn objects
+		uint32_t	clustersCulled = 0;
+		uint32_t	instancedObjects = 0; //drawn objects that went through an instanced group
+		uint32_t	drawCalls = 0; //draw commands recorded, direct and indirect
+		uint32_t	objectsDropped = 0; //visible but not drawn, the object buffer was full
+	};
+
+	class SimpleRenderSystem : public QueueEmitter
 	{
 		public:
 			SimpleRenderSystem(EngineDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
@@ -21,19 +40,71 @@ namespace wind
 			SimpleRenderSystem(const SimpleRenderSystem & ) = delete;
 			SimpleRenderSystem& operator=(const SimpleRenderSystem & ) = delete;
 
-			void applyPhysics(s_frame_info &frameinfo, GlobalUBO &ubo);
-			void renderGameObjects(s_frame_info &frameinfo);
-			float floor_y;
+			//gpu driven mode only, records the culling dispatch, call it before the render pass begins
+			void cullGameObjects(s_frame_info &frameinfo);
+			//culls and puts a packet per visible object in the queue, the draws are recorded by emit
+			void submit(s_frame_info &frameinfo, RenderQueue &queue);
+			void emit(s_frame_info &frameinfo, const DrawPacket *packets, size_t count, RenderState &state) override;
+			bool supportsGpuDriven() const { return gpuCulling != nullptr; }
+			bool gpuDriven = false; //cull and pick lods in a compute shader, ignored when not supported
+			float lodErrorThreshold = 1.f; //pixels, the coarsest lod under it gets drawn
+			const RenderStats &getStats() const { return stats; } //counts of the last submit and its emits
 
 
 		private:
 			void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
 			void CreatePipeline(VkRenderPass renderPass);
+			uint32_t selectLod(const LveModel &model, const glm::mat4 &modelMatrix, float scale, const s_frame_info &frameInfo) const;
+			void createIndirectBuffers();
+			void createObjectBuffers();
+			//culls the model meshlets and draws the survivors through the indirect buffer, false if it could not
+			bool drawMeshlets(const LveModel &model, const glm::mat4 &modelMatrix, float scale, const s_frame_info &frameInfo, uint32_t objectIndex);
 			
 			EngineDevice& device;
 
-			std::unique_ptr<Pipeline> pipeline; //probly stack allocatable
+			std::array<std::unique_ptr<Pipeline>, LveModel::VERTEX_FORMAT_COUNT> pipelines; //one per vertex layout, same layout and shaders otherwise
 			VkPipelineLayout pipelineLayout;
+			bool backfaceCulling = false; //meshlet cone culling is only allowed when the pipelines drop back faces too
+
+			static constexpr uint32_t MAX_INDIRECT_DRAWS = 16384; //per frame, past that objects are drawn whole
+			std::array<t_buffer, LveSwapChain::MAX_FRAMES_IN_FLIGHT> indirectBuffers; //host visible, mapped for their whole life
+			//ObjectData of every object drawn this frame, in draw order, read by the vertex shader through gl_InstanceIndex
+			//one per frame in flight, the cpu writes a frame while the gpu may still read the previous one
+			static constexpr uint32_t MAX_OBJECTS = GpuCulling::MAX_OBJECTS; //per frame, past that objects are not drawn
+			static constexpr uint32_t MIN_INSTANCES = 2; //a lone object is drawn on its own and keeps its meshlet culling
+			std::array<t_buffer, LveSwapChain::MAX_FRAMES_IN_FLIGHT> objectBuffers; //host visible, mapped for their whole life
+			VkDescriptorSetLayout		objectSetLayout = VK_NULL_HANDLE; //set 1
+			DescriptorPool				objectDescriptorPool{};
+			std::array<VkDescriptorSet, LveSwapChain::MAX_FRAMES_IN_FLIGHT> objectDescriptorSets{};
+
+			RenderStats stats{};
+			bool		warnedDropped = false; //a full object buffer is only logged the first time
+			//per frame scratch, kept to reuse the allocations
+			struct DrawCandidate
+			{
+				LveModel			*model;
+				TransformComponent	*transform;
+				glm::mat4			modelMatrix;
+			};
+			std::vector<DrawCandidate>	candidates;
+			SphereBatch					candidateBounds;
+			std::vector<uint8_t>		candidateVisible;
+			struct DrawItem
+			{
+				LveModel	*model;
+				uint32_t	lod;
+				uint32_t	candidate;
+			};
+			std::vector<DrawItem>		drawItems; //visible candidates, the queue packets index them
+			std::unordered_map<const LveModel *, uint32_t> meshIds; //small per frame ids for the sort keys
+			glm::vec4					frustumPlanes[6];
+			uint32_t					indirectCursor = 0; //next free command in this frame indirect buffer
+			uint32_t					objectCursor = 0; //next free entry in this frame object buffer
+			static constexpr uint32_t	GPU_CULLED_ITEM = UINT32_MAX; //packet item of the whole gpu culled batch
+
+			std::unique_ptr<GpuCulling>	gpuCulling; //null when the device can't do it
+			bool						gpuCulledFrame = false; //cullGameObjects dispatched for the frame being recorded
+			std::vector<Entity>			gpuLeftovers; //objects the gpu path did not take, drawn the cpu way
 
 			//physical properties
 
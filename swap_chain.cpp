@@ -49,7 +49,7 @@ LveSwapChain::~LveSwapChain()
 	for (int i = 0; i < depthImages.size(); i++) {
 		vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
 		vkDestroyImage(device.device(), depthImages[i], nullptr);
-		vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+		device.freeMemory(depthImageMemorys[i]);
 	}
 
 	for (auto framebuffer : swapChainFramebuffers) {
@@ -113,6 +113,7 @@ VkResult LveSwapChain::submitCommandBuffers(
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
+	std::lock_guard<std::mutex> lock(device.queueMutex()); //held through present, the queues can be the same
 	if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
 			VK_SUCCESS)
 	{
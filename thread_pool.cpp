@@ -0,0 +1,77 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace wind
+{
+	ThreadPool::ThreadPool(unsigned workerCount)
+	{
+		if (workerCount == 0)
+			workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+		workers.reserve(workerCount);
+		for (unsigned i = 0; i < workerCount; i++)
+			workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto &worker : workers)
+			worker.join();
+	}
+
+	void ThreadPool::run(size_t count, const std::function<void(size_t)> &task)
+	{
+		if (count == 0)
+			return;
+		Job job{&task, count, {}};
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			for (size_t i = 1; i < count; i++)
+				tasks.push_back({&job, i});
+		}
+		if (count > 2)
+			wake.notify_all();
+		else if (count == 2)
+			wake.notify_one();
+
+		task(0); //the caller takes the first one
+		std::unique_lock<std::mutex> lock{mutex};
+		job.remaining--;
+		//helps with whatever is queued (its own tasks or another caller's) until its job is done
+		while (job.remaining > 0)
+		{
+			if (!tasks.empty())
+				runOne(lock);
+			else
+				job.done.wait(lock);
+		}
+	}
+
+	void ThreadPool::runOne(std::unique_lock<std::mutex> &lock)
+	{
+		Task next = tasks.front();
+		tasks.pop_front();
+		lock.unlock();
+		(*next.job->task)(next.index);
+		lock.lock();
+		if (--next.job->remaining == 0)
+			next.job->done.notify_all();
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		std::unique_lock<std::mutex> lock{mutex};
+		while (true)
+		{
+			wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty()) //stopping
+				return;
+			runOne(lock);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wind
+{
+	//workers started once and kept for the whole run, so splitting a job costs a wake up instead of a thread creation
+	//several threads can hand it work at the same time (the main thread and the streamer both parse models)
+	class ThreadPool
+	{
+		public:
+			//0 means one worker less than the hardware threads, the caller of run() works too
+			ThreadPool(unsigned workerCount = 0);
+			~ThreadPool(); //waits for the workers, nothing may be running anymore
+
+			ThreadPool(const ThreadPool &) = delete;
+			ThreadPool& operator=(const ThreadPool &) = delete;
+
+			//calls task(0) .. task(count - 1) spread over the workers and the calling thread, returns once all are done
+			//the caller runs queued tasks while it waits so calling it from a task can't deadlock, tasks must not throw
+			void run(size_t count, const std::function<void(size_t)> &task);
+			//threads run() can use at once, the caller included
+			unsigned getThreadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+		private:
+			struct Job
+			{
+				const std::function<void(size_t)>	*task;
+				size_t								remaining; //guarded by the pool mutex
+				std::condition_variable				done;
+			};
+			struct Task
+			{
+				Job		*job;
+				size_t	index;
+			};
+
+			void workerLoop();
+			//pops one task and runs it, the lock is released meanwhile
+			void runOne(std::unique_lock<std::mutex> &lock);
+
+			std::mutex				mutex;
+			std::condition_variable	wake;
+			std::deque<Task>		tasks;
+			bool					stopping = false;
+			std::vector<std::thread> workers; //last, they start once the rest is initialised
+	};
+}
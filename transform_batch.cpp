@@ -0,0 +1,160 @@
+#include "transform_batch.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WIND_TRANSFORM_SSE 1
+#endif
+
+namespace wind
+{
+	namespace
+	{
+#ifdef WIND_TRANSFORM_SSE
+		//cephes sin and cos of 4 angles at once : reduction to [-pi/4, pi/4] by octant, then both polynomials
+		void sinCos(__m128 x, __m128 &sine, __m128 &cosine)
+		{
+			const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000)));
+			__m128 sineSign = _mm_and_ps(x, signMask);
+			x = _mm_andnot_ps(signMask, x);
+
+			//octant, rounded up to even so the remainder is centered on 0
+			__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f))); //4 / pi
+			octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+			const __m128 y = _mm_cvtepi32_ps(octant);
+
+			sineSign = _mm_xor_ps(sineSign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29)));
+			const __m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(
+				_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+			//octants 2 and 6 swap the polynomials
+			const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+			//pi / 4 in three parts so the subtraction stays exact
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+			x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+			const __m128 z = _mm_mul_ps(x, x);
+
+			__m128 cosPoly = _mm_set1_ps(2.443315711809948e-5f);
+			cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(-1.388731625493765e-3f));
+			cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(4.166664568298827e-2f));
+			cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+			cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.f));
+
+			__m128 sinPoly = _mm_set1_ps(-1.9515295891e-4f);
+			sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(8.3321608736e-3f));
+			sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(-1.6666654611e-1f));
+			sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+			sine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sinPoly), _mm_andnot_ps(swap, cosPoly)), sineSign);
+			cosine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cosPoly), _mm_andnot_ps(swap, sinPoly)), cosineSign);
+		}
+#endif
+	}
+
+	size_t TransformBatch::update(Scene &scene)
+	{
+		dirty.clear();
+		translationX.clear();
+		translationY.clear();
+		translationZ.clear();
+		rotationX.clear();
+		rotationY.clear();
+		rotationZ.clear();
+		scale.clear();
+		for (TransformComponent &transform : scene.transforms)
+		{
+			if (transform.isDirty())
+				gather(transform);
+		}
+
+		const size_t count = dirty.size();
+		world.resize(count);
+		normal.resize(count);
+		compose(count);
+		for (size_t i = 0; i < count; i++)
+			dirty[i]->store(world[i], normal[i]);
+		return count;
+	}
+
+	void TransformBatch::gather(TransformComponent &transform)
+	{
+		dirty.push_back(&transform);
+		translationX.push_back(transform.translation.x);
+		translationY.push_back(transform.translation.y);
+		translationZ.push_back(transform.translation.z);
+		rotationX.push_back(transform.rotation.x);
+		rotationY.push_back(transform.rotation.y);
+		rotationZ.push_back(transform.rotation.z);
+		scale.push_back(transform.scale);
+	}
+
+	//same matrices as TransformComponent::compose, columns of the YXZ rotation written out
+	void TransformBatch::compose(size_t count)
+	{
+		size_t i = 0;
+
+#ifdef WIND_TRANSFORM_SSE
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 s1, c1, s2, c2, s3, c3;
+			sinCos(_mm_loadu_ps(&rotationY[i]), s1, c1);
+			sinCos(_mm_loadu_ps(&rotationX[i]), s2, c2);
+			sinCos(_mm_loadu_ps(&rotationZ[i]), s3, c3);
+			const __m128 s = _mm_loadu_ps(&scale[i]);
+			//a zero scale has no inverse, its normal matrix is left at zero like the scalar path
+			const __m128 inverseScale = _mm_and_ps(_mm_cmpneq_ps(s, zero), _mm_div_ps(one, s));
+
+			const __m128 s1s2 = _mm_mul_ps(s1, s2);
+			const __m128 c1s2 = _mm_mul_ps(c1, s2);
+			__m128 rotation[3][3] = {
+				{_mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(s1s2, s3)), _mm_mul_ps(c2, s3), _mm_sub_ps(_mm_mul_ps(c1s2, s3), _mm_mul_ps(c3, s1))},
+				{_mm_sub_ps(_mm_mul_ps(s1s2, c3), _mm_mul_ps(c1, s3)), _mm_mul_ps(c2, c3), _mm_add_ps(_mm_mul_ps(c1s2, c3), _mm_mul_ps(s1, s3))},
+				{_mm_mul_ps(c2, s1), _mm_sub_ps(zero, s2), _mm_mul_ps(c1, c2)}};
+
+			//4 objects per register, transposed into one column per object
+			alignas(16) float worldColumns[3][3][4];
+			alignas(16) float normalColumns[3][3][4];
+			for (int column = 0; column < 3; column++)
+			{
+				for (int row = 0; row < 3; row++)
+				{
+					_mm_store_ps(worldColumns[column][row], _mm_mul_ps(rotation[column][row], s));
+					_mm_store_ps(normalColumns[column][row], _mm_mul_ps(rotation[column][row], inverseScale));
+				}
+			}
+			for (int k = 0; k < 4; k++)
+			{
+				glm::mat4 &w = world[i + k];
+				glm::mat4 &n = normal[i + k];
+				for (int column = 0; column < 3; column++)
+				{
+					w[column] = glm::vec4(worldColumns[column][0][k], worldColumns[column][1][k], worldColumns[column][2][k], 0.f);
+					n[column] = glm::vec4(normalColumns[column][0][k], normalColumns[column][1][k], normalColumns[column][2][k], 0.f);
+				}
+				w[3] = glm::vec4(translationX[i + k], translationY[i + k], translationZ[i + k], 1.f);
+				n[3] = glm::vec4(0.f, 0.f, 0.f, 1.f);
+			}
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			const float c3 = glm::cos(rotationZ[i]);
+			const float s3 = glm::sin(rotationZ[i]);
+			const float c2 = glm::cos(rotationX[i]);
+			const float s2 = glm::sin(rotationX[i]);
+			const float c1 = glm::cos(rotationY[i]);
+			const float s1 = glm::sin(rotationY[i]);
+			const glm::mat3 rotation{
+				{c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1},
+				{c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3},
+				{c2 * s1, -s2, c1 * c2}};
+			const float inverseScale = scale[i] != 0.f ? 1.f / scale[i] : 0.f;
+			world[i] = glm::mat4(rotation * scale[i]);
+			world[i][3] = glm::vec4(translationX[i], translationY[i], translationZ[i], 1.f);
+			normal[i] = glm::mat4(rotation * inverseScale);
+		}
+	}
+}
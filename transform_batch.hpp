@@ -0,0 +1,35 @@
+#pragma once
+
+#include "scene.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace wind
+{
+	//composes the world and normal matrices of every dirty transform once per frame, before anything reads them
+	//inputs of the dirty ones are gathered in one array per component so the YXZ matrices are built 4 at a time with SSE,
+	//clean transforms (the floor, anything that did not move) are only compared and keep their cached matrices
+	class TransformBatch
+	{
+		public:
+			//returns how many transforms were composed
+			size_t update(Scene &scene);
+
+		private:
+			std::vector<TransformComponent *>	dirty;
+			std::vector<float>	translationX;
+			std::vector<float>	translationY;
+			std::vector<float>	translationZ;
+			std::vector<float>	rotationX;
+			std::vector<float>	rotationY;
+			std::vector<float>	rotationZ;
+			std::vector<float>	scale;
+			//results, world and normal matrix of dirty[i]
+			std::vector<glm::mat4>	world;
+			std::vector<glm::mat4>	normal;
+
+			void gather(TransformComponent &transform);
+			void compose(size_t count);
+	};
+}
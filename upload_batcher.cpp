@@ -0,0 +1,327 @@
+#include "upload_batcher.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace wind
+{
+	UploadBatcher::UploadBatcher(EngineDevice &device, VkDeviceSize ringSize) : device{device}, ringSize{ringSize}
+	{
+		//16 covers every texel size, the device may want more for fast copies
+		alignment = std::max<VkDeviceSize>(16, device.properties.limits.optimalBufferCopyOffsetAlignment);
+
+		QueueFamilyIndices queueFamilyIndices = device.findPhysicalQueueFamilies();
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+			throw std::runtime_error("failed to create upload command pool");
+		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+		if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &acquirePool) != VK_SUCCESS)
+			throw std::runtime_error("failed to create upload acquire command pool");
+
+		initialise_buffer(ring,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			device, ringSize);
+	}
+
+	UploadBatcher::~UploadBatcher()
+	{
+		//something recorded but never flushed is dropped, nothing was submitted so nothing references it
+		for (t_buffer &staging : recording.oversized)
+			destroy_buffer(staging, device);
+		wait(lastSubmitted);
+
+		if (recording.commandBuffer != VK_NULL_HANDLE)
+			spare.push_back(recording);
+		for (Batch &batch : spare)
+		{
+			vkFreeCommandBuffers(device.device(), commandPool, 1, &batch.commandBuffer);
+			vkFreeCommandBuffers(device.device(), acquirePool, 1, &batch.acquireCommands);
+			vkDestroyFence(device.device(), batch.fence, nullptr);
+			vkDestroyFence(device.device(), batch.acquireFence, nullptr);
+			vkDestroySemaphore(device.device(), batch.copied, nullptr);
+		}
+		vkDestroyCommandPool(device.device(), commandPool, nullptr);
+		vkDestroyCommandPool(device.device(), acquirePool, nullptr);
+		destroy_buffer(ring, device);
+	}
+
+	void UploadBatcher::beginRecording()
+	{
+		if (recording.commandBuffer != VK_NULL_HANDLE)
+			return;
+		if (!spare.empty())
+		{
+			recording = std::move(spare.back());
+			spare.pop_back();
+		}
+		else
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = commandPool;
+			allocInfo.commandBufferCount = 1;
+			if (vkAllocateCommandBuffers(device.device(), &allocInfo, &recording.commandBuffer) != VK_SUCCESS)
+				throw std::runtime_error("failed to allocate upload command buffer");
+			allocInfo.commandPool = acquirePool;
+			if (vkAllocateCommandBuffers(device.device(), &allocInfo, &recording.acquireCommands) != VK_SUCCESS)
+				throw std::runtime_error("failed to allocate upload acquire command buffer");
+
+			VkFenceCreateInfo fenceInfo{};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			if (vkCreateFence(device.device(), &fenceInfo, nullptr, &recording.fence) != VK_SUCCESS ||
+				vkCreateFence(device.device(), &fenceInfo, nullptr, &recording.acquireFence) != VK_SUCCESS ||
+				vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &recording.copied) != VK_SUCCESS)
+				throw std::runtime_error("failed to create upload sync objects");
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(recording.commandBuffer, &beginInfo);
+	}
+
+	VkDeviceSize UploadBatcher::allocate(VkDeviceSize size)
+	{
+		for (;;)
+		{
+			if (inFlight.empty() && recording.commandBuffer == VK_NULL_HANDLE) //nothing alive, start over at 0
+			{
+				head = tail = 0;
+				wrapped = false;
+			}
+
+			VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+			if (!wrapped)
+			{
+				if (offset + size <= ringSize)
+				{
+					head = offset + size;
+					return offset;
+				}
+				if (size <= tail) //the end of the ring is too short, go around
+				{
+					wrapped = true;
+					head = size;
+					return 0;
+				}
+			}
+			else if (offset + size <= tail)
+			{
+				head = offset + size;
+				return offset;
+			}
+
+			//full : push what we have and wait for the oldest batch to hand its space back
+			if (recording.commandBuffer != VK_NULL_HANDLE)
+				flush();
+			retireOldest();
+		}
+	}
+
+	void UploadBatcher::copyToBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size)
+	{
+		VkBufferCopy copyRegion{};
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+
+		if (size > ringSize)
+		{
+			beginRecording();
+			t_buffer staging{};
+			initialise_buffer(staging,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				device, size);
+			recording.oversized.push_back(staging);
+			memcpy(staging.data, data, static_cast<size_t>(size));
+			vkCmdCopyBuffer(recording.commandBuffer, staging.buffer, dst, 1, &copyRegion);
+			addBufferBarrier(dst, dstOffset, size);
+			return;
+		}
+
+		VkDeviceSize offset = allocate(size); //may flush, record after it
+		beginRecording();
+		memcpy(static_cast<char *>(ring.data) + offset, data, static_cast<size_t>(size));
+		copyRegion.srcOffset = offset;
+		vkCmdCopyBuffer(recording.commandBuffer, ring.buffer, dst, 1, &copyRegion);
+		addBufferBarrier(dst, dstOffset, size);
+		recording.ringEnd = head;
+	}
+
+	void UploadBatcher::copyToImage(VkImage dst, uint32_t width, uint32_t height, uint32_t layerCount, const void *data, VkDeviceSize size)
+	{
+		if (size > ringSize)
+			throw std::runtime_error("image upload does not fit the staging ring");
+
+		VkDeviceSize offset = allocate(size);
+		beginRecording();
+		memcpy(static_cast<char *>(ring.data) + offset, data, static_cast<size_t>(size));
+
+		VkBufferImageCopy region{};
+		region.bufferOffset = offset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = layerCount;
+		region.imageOffset = {0, 0, 0};
+		region.imageExtent = {width, height, 1};
+		vkCmdCopyBufferToImage(recording.commandBuffer, ring.buffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		recording.ringEnd = head;
+
+		VkImageMemoryBarrier barrier{};
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.image = dst;
+		barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layerCount};
+		recording.imageBarriers.push_back(barrier);
+	}
+
+	void UploadBatcher::addBufferBarrier(VkBuffer dst, VkDeviceSize offset, VkDeviceSize size)
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.buffer = dst;
+		barrier.offset = offset;
+		barrier.size = size;
+		recording.bufferBarriers.push_back(barrier);
+	}
+
+	uint64_t UploadBatcher::flush()
+	{
+		if (recording.commandBuffer == VK_NULL_HANDLE)
+			return lastSubmitted;
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(recording.acquireCommands, &beginInfo);
+		device.recordOwnershipTransfer(recording.commandBuffer, recording.acquireCommands, recording.bufferBarriers, recording.imageBarriers);
+		vkEndCommandBuffer(recording.acquireCommands);
+		vkEndCommandBuffer(recording.commandBuffer);
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &recording.commandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &recording.copied;
+		{
+			std::lock_guard<std::mutex> lock(device.queueMutex());
+			if (vkQueueSubmit(device.transferQueue(), 1, &submitInfo, recording.fence) != VK_SUCCESS)
+				throw std::runtime_error("failed to submit upload batch");
+		}
+
+		//a batch with only oversized copies did not move head, it must not move tail either
+		if (recording.ringEnd == 0 && recording.oversized.size() > 0)
+			recording.ringEnd = inFlight.empty() ? tail : inFlight.back().ringEnd;
+		recording.ticket = ++lastSubmitted;
+		inFlight.push_back(std::move(recording));
+		recording = Batch{};
+		return lastSubmitted;
+	}
+
+	void UploadBatcher::discard()
+	{
+		if (recording.commandBuffer == VK_NULL_HANDLE)
+			return;
+
+		vkEndCommandBuffer(recording.commandBuffer);
+		vkResetCommandBuffer(recording.commandBuffer, 0);
+		for (t_buffer &staging : recording.oversized)
+			destroy_buffer(staging, device);
+		//the ring space it took is given back when the next batch retires, or right away if none is in flight
+		Batch recycled{};
+		recycled.commandBuffer = recording.commandBuffer;
+		recycled.acquireCommands = recording.acquireCommands;
+		recycled.fence = recording.fence;
+		recycled.acquireFence = recording.acquireFence;
+		recycled.copied = recording.copied;
+		spare.push_back(std::move(recycled));
+		recording = Batch{};
+	}
+
+	//the copies are finished, the semaphore is already signaled so the graphics queue won't wait on it
+	void UploadBatcher::submitAcquire(Batch &batch)
+	{
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &batch.copied;
+		submitInfo.pWaitDstStageMask = &waitStage;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.acquireCommands;
+		{
+			std::lock_guard<std::mutex> lock(device.queueMutex());
+			if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, batch.acquireFence) != VK_SUCCESS)
+				throw std::runtime_error("failed to submit upload acquire");
+		}
+		batch.acquireSubmitted = true;
+	}
+
+	void UploadBatcher::retireOldest()
+	{
+		if (inFlight.empty())
+			return;
+		Batch &batch = inFlight.front();
+		if (!batch.acquireSubmitted)
+		{
+			vkWaitForFences(device.device(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+			submitAcquire(batch);
+		}
+		vkWaitForFences(device.device(), 1, &batch.acquireFence, VK_TRUE, UINT64_MAX);
+
+		if (batch.ringEnd < tail) //tail follows head around the end of the ring
+			wrapped = false;
+		tail = batch.ringEnd;
+		lastCompleted = batch.ticket;
+		for (t_buffer &staging : batch.oversized)
+			destroy_buffer(staging, device);
+
+		VkFence fences[2] = {batch.fence, batch.acquireFence};
+		vkResetFences(device.device(), 2, fences);
+		vkResetCommandBuffer(batch.commandBuffer, 0);
+		vkResetCommandBuffer(batch.acquireCommands, 0);
+		Batch recycled{};
+		recycled.commandBuffer = batch.commandBuffer;
+		recycled.acquireCommands = batch.acquireCommands;
+		recycled.fence = batch.fence;
+		recycled.acquireFence = batch.acquireFence;
+		recycled.copied = batch.copied;
+		spare.push_back(std::move(recycled));
+		inFlight.pop_front();
+	}
+
+	bool UploadBatcher::isComplete(uint64_t ticket)
+	{
+		//the transfer queue finishes batches in order, hand each finished one to the graphics queue
+		for (Batch &batch : inFlight)
+		{
+			if (batch.acquireSubmitted)
+				continue;
+			if (vkGetFenceStatus(device.device(), batch.fence) != VK_SUCCESS)
+				break;
+			submitAcquire(batch);
+		}
+		while (!inFlight.empty() && inFlight.front().acquireSubmitted &&
+			vkGetFenceStatus(device.device(), inFlight.front().acquireFence) == VK_SUCCESS)
+			retireOldest();
+		return lastCompleted >= ticket;
+	}
+
+	void UploadBatcher::wait(uint64_t ticket)
+	{
+		while (lastCompleted < ticket && !inFlight.empty())
+			retireOldest();
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "engine.hpp"
+#include "initialise_buffers.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace wind
+{
+	//collects buffer and image uploads into one command buffer and submits them to the transfer queue
+	//staging memory comes from a persistently mapped ring, space is handed back as the fences signal,
+	//the queue itself is never idled
+	//when a batch is done copying, a small graphics command buffer waits on its semaphore and acquires the
+	//destinations for the graphics family. it is only submitted once the copies are finished so frames queued
+	//meanwhile never stall on an upload, a ticket completes when that acquire has run
+	//single threaded : use one batcher per thread
+	class UploadBatcher
+	{
+		public:
+			static constexpr VkDeviceSize DEFAULT_RING_SIZE = 16 * 1024 * 1024;
+
+			UploadBatcher(EngineDevice &device, VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+			~UploadBatcher(); //waits for everything it submitted
+
+			UploadBatcher(const UploadBatcher &) = delete;
+			UploadBatcher& operator=(const UploadBatcher &) = delete;
+
+			//dst must have been created with VK_BUFFER_USAGE_TRANSFER_DST_BIT
+			void copyToBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size);
+			//image must already be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, data is tightly packed
+			//once the ticket completes it is in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			void copyToImage(VkImage dst, uint32_t width, uint32_t height, uint32_t layerCount, const void *data, VkDeviceSize size);
+
+			//submits what has been recorded so far, returns a ticket to wait on (nothing recorded gives the last ticket)
+			uint64_t flush();
+			//drops what has been recorded since the last flush without submitting it, for when a load throws
+			//after recording copies into buffers it then freed. earlier flushes are not affected
+			void discard();
+			bool isComplete(uint64_t ticket); //never blocks, recycles the staging space of finished batches
+			void wait(uint64_t ticket);
+
+		private:
+			struct Batch
+			{
+				VkCommandBuffer			commandBuffer = VK_NULL_HANDLE; //transfer queue
+				VkCommandBuffer			acquireCommands = VK_NULL_HANDLE; //graphics queue
+				VkFence					fence = VK_NULL_HANDLE; //copies done
+				VkFence					acquireFence = VK_NULL_HANDLE; //graphics family owns the results
+				VkSemaphore				copied = VK_NULL_HANDLE;
+				bool					acquireSubmitted = false;
+				VkDeviceSize			ringEnd = 0; //tail moves here once the batch is done
+				std::vector<t_buffer>	oversized; //uploads bigger than the ring get their own staging buffer
+				std::vector<VkBufferMemoryBarrier> bufferBarriers;
+				std::vector<VkImageMemoryBarrier> imageBarriers;
+				uint64_t				ticket = 0;
+			};
+
+			EngineDevice		&device;
+			VkCommandPool		commandPool; //transfer family
+			VkCommandPool		acquirePool; //graphics family
+			t_buffer			ring{};
+			VkDeviceSize		ringSize;
+			VkDeviceSize		alignment;
+
+			//live staging data is [tail, head) or, once wrapped, [tail, ringSize) + [0, head)
+			VkDeviceSize		head = 0;
+			VkDeviceSize		tail = 0;
+			bool				wrapped = false;
+
+			Batch				recording{}; //commandBuffer stays null until something is recorded
+			std::deque<Batch>	inFlight; //oldest first, they retire in submit order
+			std::vector<Batch>	spare; //retired command buffers and sync objects, reset and ready
+			uint64_t			lastSubmitted = 0;
+			uint64_t			lastCompleted = 0;
+
+			void beginRecording();
+			//returns the staging offset of size bytes, flushing and waiting for older batches if the ring is full
+			VkDeviceSize allocate(VkDeviceSize size);
+			void addBufferBarrier(VkBuffer dst, VkDeviceSize offset, VkDeviceSize size);
+			void submitAcquire(Batch &batch);
+			void retireOldest();
+	};
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace wind
+{
+	//flat open addressing table used to weld identical vertices together at import
+	//values are compared and hashed as raw bytes so T must be a padding free struct of floats only (Vertex, glm::vec3),
+	//-0.0 is turned into 0.0 first so the two still weld like they did with operator==
+	template <typename T>
+	class WeldTable
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "WeldTable hashes raw bytes");
+		static_assert(sizeof(T) % sizeof(float) == 0, "WeldTable values are made of floats");
+
+		public:
+			//maxValues is an upper bound on the unique count (the index count works), the table never grows
+			WeldTable(std::vector<T> &uniqueValues, size_t maxValues) : values{uniqueValues}
+			{
+				size_t capacity = 16;
+				while (capacity < maxValues * 2) //load factor stays under 0.5 so probe chains stay short
+					capacity <<= 1;
+				mask = capacity - 1;
+				slots.assign(capacity, Slot{EMPTY, 0});
+				//only the slots are sized for the worst case, a closed mesh has around one unique vertex per 4 to 6
+				//corners so reserving maxValues values would take more memory than the welding saves
+				values.reserve(values.size() + maxValues / 4);
+			}
+
+			WeldTable(const WeldTable &) = delete;
+			WeldTable& operator=(const WeldTable &) = delete;
+
+			//single probe sequence, returns the index of the equal value already stored or appends it
+			uint32_t weld(const T &value)
+			{
+				const T key = canonical(value);
+				uint64_t hash = hashBytes(&key, sizeof(T));
+				uint32_t tag = static_cast<uint32_t>(hash >> 32); //cheap check before the memcmp
+				size_t slot = static_cast<size_t>(hash) & mask;
+				while (true)
+				{
+					Slot &entry = slots[slot];
+					if (entry.index == EMPTY)
+					{
+						entry.index = static_cast<uint32_t>(values.size());
+						entry.tag = tag;
+						values.push_back(value);
+						return entry.index;
+					}
+					if (entry.tag == tag)
+					{
+						//the stored value is the first one seen, it may hold a -0.0 too
+						const T stored = canonical(values[entry.index]);
+						if (std::memcmp(&stored, &key, sizeof(T)) == 0)
+							return entry.index;
+					}
+					slot = (slot + 1) & mask;
+				}
+			}
+
+		private:
+			struct Slot
+			{
+				uint32_t index;
+				uint32_t tag;
+			};
+			static constexpr uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+
+			//-0.0 + 0.0 is 0.0, every other float is left as it is
+			static T canonical(const T &value)
+			{
+				float floats[sizeof(T) / sizeof(float)];
+				std::memcpy(floats, &value, sizeof(T));
+				for (float &f : floats)
+					f += 0.f;
+				T result;
+				std::memcpy(&result, floats, sizeof(T));
+				return result;
+			}
+
+			std::vector<T>		&values;
+			std::vector<Slot>	slots;
+			size_t				mask;
+	};
+}